@@ -6,8 +6,10 @@
 #define UART_GPS_ID       uart1
 #define UART_GPS_TX       8
 #define UART_GPS_RX       9
-#define UART_GPS_BAUD     9600
+#define UART_GPS_BAUD     9600     // module default
+#define UART_GPS_BAUD_FAST 115200   // flight mode (set via UBX CFG-PRT)
 #define PIN_GPS_PPS       10
 #define I2C_SI_ID         i2c0
 #define PIN_I2C_SDA       4
 #define PIN_I2C_SCL       5
+#define PIN_VSYS_ADC      29   // VSYS / 3 on the Pico (ADC3); telemetry voltage
@@ -1,57 +1,149 @@
 #include "pico/stdlib.h"
 #include "hardware/uart.h"
 #include "hardware/gpio.h"
+#include "hardware/irq.h"
 #include "timebase.h"
 #include "FreeRTOS.h"
 #include "task.h"
+#include "event_groups.h"
 #include "logging.h"
 #include "pico_wspr_horus.h"
 #include "gps_hw.h"
-#include <string.h> // strchr, strlen, memcpy, strncmp, strstr
-#include <stdlib.h> // atoi, atof
-#include <math.h>   // floor
+#include "gps_nmea.h"
+#include "gps_ubx.h"
+#include "msg_bus.h"
+#include "nav_predict.h"
+#include "app_rtos.h"
+#include <stdlib.h> // labs
 
 static TaskHandle_t s_mon_task = NULL;   // task handle lives at file scope
+static uint32_t s_baud = UART_GPS_BAUD;  // rate the host UART is currently at
 static void gps_monitor_task(void *arg); // forward declaration
 
-// --------- NMEA helpers ----------
-static uint8_t hexval(char c) { return (c >= '0' && c <= '9')   ? (uint8_t)(c - '0')
-                                       : (c >= 'A' && c <= 'F') ? (uint8_t)(10 + c - 'A')
-                                       : (c >= 'a' && c <= 'f') ? (uint8_t)(10 + c - 'a')
-                                                                : 0xFF; }
+// --------- RX ring (filled from the UART IRQ, drained by the monitor task) ----------
+// The task is woken at end-of-line (NMEA), on RX idle (UBX) or at half full.
+#define GPS_RX_RING_SIZE 1024u          // power of two; ~1 s of 9600 baud
+#define GPS_RX_RING_MASK (GPS_RX_RING_SIZE - 1u)
 
-static bool nmea_checksum_ok(const char *s)
+static uint8_t s_rx_ring[GPS_RX_RING_SIZE];
+static volatile uint16_t s_rx_head = 0;  // written by ISR only
+static volatile uint16_t s_rx_tail = 0;  // written by task only
+static volatile gps_rx_stats_t s_rx_stats;
+
+static void gps_uart_irq(void)
 {
-  // s like "$GPRMC,...*CS"
-  if (!s || s[0] != '$')
-    return false;
-  const char *p = s + 1;
-  uint8_t x = 0;
-  while (*p && *p != '*' && *p != '\r' && *p != '\n')
+  BaseType_t woken = pdFALSE;
+  uart_hw_t *hw = uart_get_hw(UART_GPS_ID);
+  // RX timeout = line went idle after a burst; that's end-of-frame for UBX
+  bool eol = (hw->mis & UART_UARTMIS_RTMIS_BITS) != 0;
+
+  while (uart_is_readable(UART_GPS_ID))
   {
-    x ^= (uint8_t)(*p++);
+    uint32_t dr = hw->dr;                 // data + error flags for this byte
+    if (dr & UART_UARTDR_OE_BITS)
+      s_rx_stats.overruns++;              // HW FIFO overflowed before we got here
+    uint8_t c = (uint8_t)(dr & 0xFF);
+    s_rx_stats.rx_bytes++;
+
+    uint16_t head = s_rx_head;
+    uint16_t next = (uint16_t)((head + 1u) & GPS_RX_RING_MASK);
+    if (next == s_rx_tail)
+    {
+      s_rx_stats.dropped++;               // ring full: parser is behind
+      continue;
+    }
+    s_rx_ring[head] = c;
+    s_rx_head = next;
+
+    uint16_t used = (uint16_t)((next - s_rx_tail) & GPS_RX_RING_MASK);
+    if (used > s_rx_stats.ring_hwm)
+      s_rx_stats.ring_hwm = used;
+    if (c == '\n' || used >= GPS_RX_RING_SIZE / 2)
+      eol = true;
   }
-  if (*p != '*')
-    return false;
-  if (!p[1] || !p[2])
-    return false;
-  uint8_t hi = hexval(p[1]), lo = hexval(p[2]);
-  if (hi > 0x0F || lo > 0x0F)
+
+  if (eol && s_mon_task)
+  {
+    vTaskNotifyGiveFromISR(s_mon_task, &woken);
+    portYIELD_FROM_ISR(woken);
+  }
+}
+
+static bool gps_rx_pop(uint8_t *c)
+{
+  uint16_t tail = s_rx_tail;
+  if (tail == s_rx_head)
     return false;
-  uint8_t want = (uint8_t)((hi << 4) | lo);
-  return x == want;
+  *c = s_rx_ring[tail];
+  s_rx_tail = (uint16_t)((tail + 1u) & GPS_RX_RING_MASK);
+  return true;
+}
+
+void gps_rx_get_stats(gps_rx_stats_t *out)
+{
+  if (!out)
+    return;
+  uint32_t irq = UART0_IRQ + uart_get_index(UART_GPS_ID);
+  bool was = irq_is_enabled(irq);
+  irq_set_enabled(irq, false);
+  out->rx_bytes = s_rx_stats.rx_bytes;
+  out->lines = s_rx_stats.lines;
+  out->overruns = s_rx_stats.overruns;
+  out->dropped = s_rx_stats.dropped;
+  out->ring_hwm = s_rx_stats.ring_hwm;
+  irq_set_enabled(irq, was);
+}
+
+// --------- PPS ----------
+static volatile uint32_t s_pps_edges = 0;
+
+static void gps_pps_isr(uint gpio, uint32_t events)
+{
+  uint64_t t = time_us_64(); // first thing: keep IRQ latency out of the stamp
+  if (gpio != PIN_GPS_PPS || !(events & GPIO_IRQ_EDGE_RISE))
+    return;
+  timebase_pps_from_isr(t);
+  s_pps_edges++;
+}
+
+static void gps_pps_init(void)
+{
+  static bool inited = false;
+  if (inited)
+    return;
+  gpio_init(PIN_GPS_PPS);
+  gpio_set_dir(PIN_GPS_PPS, GPIO_IN);
+  gpio_set_irq_enabled_with_callback(PIN_GPS_PPS, GPIO_IRQ_EDGE_RISE, true, gps_pps_isr);
+  inited = true;
+}
+
+uint32_t gps_pps_edges(void)
+{
+  return s_pps_edges;
 }
 
 // --------- UART & power control ----------
 void gps_uart_enable(void)
 {
-  uart_init(UART_GPS_ID, UART_GPS_BAUD);
+  uart_init(UART_GPS_ID, s_baud);
   gpio_set_function(UART_GPS_TX, GPIO_FUNC_UART);
   gpio_set_function(UART_GPS_RX, GPIO_FUNC_UART);
+
+  // RX by interrupt: FIFO-level + receive-timeout IRQs drain the HW FIFO into s_rx_ring
+  uint32_t irq = UART0_IRQ + uart_get_index(UART_GPS_ID);
+  uart_set_fifo_enabled(UART_GPS_ID, true);
+  irq_set_exclusive_handler(irq, gps_uart_irq);
+  irq_set_enabled(irq, true);
+  uart_set_irq_enables(UART_GPS_ID, true, false);
 }
 
 void gps_uart_disable(void)
 {
+  uint32_t irq = UART0_IRQ + uart_get_index(UART_GPS_ID);
+  uart_set_irq_enables(UART_GPS_ID, false, false);
+  irq_set_enabled(irq, false);
+  irq_remove_handler(irq, gps_uart_irq);
+
   // Return pins to GPIO to mirror the C++ “ReInit” behavior on TX
   gpio_set_function(UART_GPS_TX, GPIO_FUNC_SIO);
   gpio_set_dir(UART_GPS_TX, GPIO_OUT);
@@ -126,50 +218,192 @@ void gps_hard_reset(void)
   gpio_put(PIN_GPS_RESET, 1);
 }
 
-// ---------- UBX stubs ----------
-bool gps_send_ubx(const uint8_t *payload, uint16_t len)
+// ---------- UBX ----------
+
+// ACK/NAK rendezvous between the config caller and the monitor task
+static volatile uint8_t s_ack_cls, s_ack_id;
+static volatile int8_t s_ack_result;      // -1 pending, 0 NAK, 1 ACK
+static TaskHandle_t s_ack_waiter = NULL;
+
+bool gps_send_ubx(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len)
+{
+  uint8_t frame[48];
+  uint16_t n = ubx_frame(cls, id, payload, len, frame, sizeof(frame));
+  if (!n)
+    return false;
+  uart_write_blocking(UART_GPS_ID, frame, n);
+  return true;
+}
+
+// Send and wait for UBX-ACK-ACK/NAK for (cls,id). Needs the monitor task
+// running (it owns the RX path) and must not be called from it.
+bool gps_send_ubx_ack(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len,
+                      uint32_t timeout_ms)
 {
-  // Replace with real UBX framing (0xB5 0x62 + payload + CK_A/CK_B)
-  // For now, just write raw (safe stub)
-  if (!payload || !len)
+  if (!s_mon_task || xTaskGetCurrentTaskHandle() == s_mon_task)
     return false;
-  for (uint16_t i = 0; i < len; i++)
+
+  s_ack_cls = cls;
+  s_ack_id = id;
+  s_ack_result = -1;
+  ulTaskNotifyTake(pdTRUE, 0); // clear any stale give
+  s_ack_waiter = xTaskGetCurrentTaskHandle();
+
+  bool ok = gps_send_ubx(cls, id, payload, len);
+  if (ok)
   {
-    uart_putc_raw(UART_GPS_ID, payload[i]);
+    TickType_t t0 = xTaskGetTickCount();
+    TickType_t limit = pdMS_TO_TICKS(timeout_ms);
+    while (s_ack_result < 0 && (xTaskGetTickCount() - t0) < limit)
+      ulTaskNotifyTake(pdTRUE, limit - (xTaskGetTickCount() - t0));
+    ok = (s_ack_result == 1);
   }
-  return true;
+  s_ack_waiter = NULL;
+
+  if (!ok)
+    LOGW("gps: UBX %02x-%02x %s", cls, id, s_ack_result == 0 ? "NAK" : "no ACK");
+  return ok;
+}
+
+// called by the monitor task for every UBX-ACK-* frame
+static void gps_on_ack(const ubx_parser_t *u)
+{
+  if (u->len < 2 || !s_ack_waiter || s_ack_result >= 0)
+    return;
+  if (u->payload[0] != s_ack_cls || u->payload[1] != s_ack_id)
+    return;
+  s_ack_result = (u->id == UBX_ACK_ACK) ? 1 : 0;
+  xTaskNotifyGive(s_ack_waiter);
+}
+
+static inline void put_u16(uint8_t *p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static inline void put_u32(uint8_t *p, uint32_t v)
+{
+  p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+static bool set_msg_rate(uint8_t cls, uint8_t id, uint8_t rate)
+{
+  const uint8_t pl[3] = {cls, id, rate}; // CFG-MSG, rate on the current port
+  return gps_send_ubx_ack(UBX_CLS_CFG, UBX_CFG_MSG, pl, sizeof(pl), 500);
+}
+
+// Is the module answering at the host's current baud? (CFG-PRT poll for UART1)
+static bool gps_probe(void)
+{
+  const uint8_t port = 1;
+  return gps_send_ubx_ack(UBX_CLS_CFG, UBX_CFG_PRT, &port, 1, 300);
+}
+
+// Find the module's rate after a power cycle: BBR may have kept the fast one
+static bool gps_sync_baud(void)
+{
+  if (gps_probe())
+    return true;
+  s_baud = (s_baud == UART_GPS_BAUD) ? UART_GPS_BAUD_FAST : UART_GPS_BAUD;
+  uart_set_baudrate(UART_GPS_ID, s_baud);
+  if (gps_probe())
+    return true;
+  LOGW("gps: no UBX reply at %u or %u baud", UART_GPS_BAUD, UART_GPS_BAUD_FAST);
+  return false;
+}
+
+// CFG-PRT: move module UART1 to `baud`, then follow it on the host side.
+// The ACK for this message is sent after the switch, so it is usually lost;
+// we verify with a probe at the new rate instead and fall back if it fails.
+static bool gps_set_baud(uint32_t baud)
+{
+  if (s_baud == baud)
+    return true;
+
+  uint8_t pl[20] = {0};
+  pl[0] = 1;                          // portID = UART1
+  put_u32(&pl[4], 0x000008D0u);       // mode: 8N1
+  put_u32(&pl[8], baud);
+  put_u16(&pl[12], 0x0003);           // inProtoMask: UBX + NMEA
+  put_u16(&pl[14], 0x0003);           // outProtoMask: UBX + NMEA
+  gps_send_ubx(UBX_CLS_CFG, UBX_CFG_PRT, pl, sizeof(pl));
+  uart_tx_wait_blocking(UART_GPS_ID);
+  vTaskDelay(pdMS_TO_TICKS(100));
+
+  uint32_t old = s_baud;
+  s_baud = baud;
+  uart_set_baudrate(UART_GPS_ID, baud);
+  if (gps_probe())
+  {
+    LOGI("gps: UART now %u baud", baud);
+    return true;
+  }
+  s_baud = old;
+  uart_set_baudrate(UART_GPS_ID, old);
+  LOGW("gps: baud switch to %u failed, staying at %u", baud, old);
+  return false;
 }
 
 // ---------- Modes from your C++ ----------
 static void send_high_altitude_mode(void)
 {
-  // TODO: fill with your UBX-CFG-NAV5 dynamic model for airborne
-  // gps_send_ubx(ubx_nav5_payload, sizeof(ubx_nav5_payload));
-  LOGI("gps: (stub) SendHighAltitudeMode");
+  // CFG-NAV5: apply only the dynamic model (mask bit0) -> 6 = airborne <1g,
+  // which keeps fixes valid above 12 km
+  uint8_t pl[36] = {0};
+  put_u16(&pl[0], 0x0001);
+  pl[2] = 6;
+  pl[3] = 3; // fixMode auto 2D/3D (ignored by mask, kept sane)
+  if (gps_send_ubx_ack(UBX_CLS_CFG, UBX_CFG_NAV5, pl, sizeof(pl), 500))
+    LOGI("gps: airborne <1g dynamic model set");
 }
 
+// Standard NMEA sentence IDs under class 0xF0
+static const uint8_t k_nmea_ids[] = {0x00 /*GGA*/, 0x01 /*GLL*/, 0x02 /*GSA*/,
+                                     0x03 /*GSV*/, 0x04 /*RMC*/, 0x05 /*VTG*/};
+
 static void send_msg_rate_maximal(void)
 {
-  // TODO: set NMEA/UBX message rates for “monitor mode” (frequent lines)
-  LOGI("gps: (stub) SendModuleMessageRateConfigurationMaximal");
+  // monitor mode: every NMEA sentence at 1 Hz for the console, no binary
+  bool ok = true;
+  for (unsigned i = 0; i < sizeof(k_nmea_ids); i++)
+    ok &= set_msg_rate(UBX_CLS_NMEA, k_nmea_ids[i], 1);
+  ok &= set_msg_rate(UBX_CLS_NAV, UBX_NAV_PVT, 0);
+  LOGI("gps: NMEA maximal output %s", ok ? "set" : "incomplete");
 }
 
 static void send_msg_rate_minimal(void)
 {
-  // TODO: set minimal output for flight (e.g., RMC/GGA 1 Hz)
-  LOGI("gps: (stub) SendModuleMessageRateConfigurationMinimal");
+  // flight: one ~100-byte NAV-PVT per second replaces all NMEA text
+  bool ok = set_msg_rate(UBX_CLS_NAV, UBX_NAV_PVT, 1);
+  for (unsigned i = 0; i < sizeof(k_nmea_ids); i++)
+    ok &= set_msg_rate(UBX_CLS_NMEA, k_nmea_ids[i], 0);
+  LOGI("gps: NAV-PVT only output %s", ok ? "set" : "incomplete");
 }
 
 static void send_save_configuration(void)
 {
-  // TODO: UBX-CFG-CFG save
-  LOGI("gps: (stub) SendModuleSaveConfiguration");
+  // CFG-CFG: save everything to BBR + flash so a hot start keeps it
+  uint8_t pl[13] = {0};
+  put_u32(&pl[4], 0x0000FFFFu);       // saveMask
+  pl[12] = 0x03;                      // deviceMask: BBR | flash
+  if (gps_send_ubx_ack(UBX_CLS_CFG, UBX_CFG_CFG, pl, sizeof(pl), 1500))
+    LOGI("gps: configuration saved");
+}
+
+static void gps_monitor_start(void)
+{
+  gps_pps_init();
+  if (!s_mon_task)
+  {
+    static StackType_t stack[APP_STACK_GPS_MON];
+    static StaticTask_t tcb;
+    s_mon_task = app_task_create(gps_monitor_task, "gpsmon", NULL, APP_PRIO_GPS_MON,
+                                 stack, APP_STACK_GPS_MON, &tcb);
+  }
 }
 
 // Public “modes”
 void gps_enable_configuration_mode(void)
 {
   gps_power_on_battery_on();
+  gps_monitor_start();
+  gps_sync_baud();
   send_high_altitude_mode();
   send_msg_rate_maximal();
   send_save_configuration();
@@ -178,6 +412,9 @@ void gps_enable_configuration_mode(void)
 void gps_enable_flight_mode(void)
 {
   gps_power_on_battery_on();
+  gps_monitor_start();
+  if (gps_sync_baud())
+    gps_set_baud(UART_GPS_BAUD_FAST);
   send_high_altitude_mode();
   send_msg_rate_minimal();
   send_save_configuration();
@@ -192,210 +429,179 @@ void gps_enter_monitor_mode(void)
 {
   // Power on + lots of messages like the C++ version’s EnableConfigurationMode + EnterMonitorMode
   gps_enable_configuration_mode();
+}
 
-  if (!s_mon_task)
+// ---------- Clean monitor task ----------
+// printf helpers for degrees*1e7 without pulling in float formatting
+#define E7_FMT "%s%ld.%07ld"
+#define E7_ARG(v) ((v) < 0 ? "-" : ""), labs((long)(v)) / 10000000L, labs((long)(v)) % 10000000L
+
+static nmea_parser_t s_nmea;
+static ubx_parser_t s_ubx;
+static gps_fix_t s_fix; // RMC + GGA merged, or straight from NAV-PVT
+
+void gps_nmea_get_stats(nmea_stats_t *out)
+{
+  if (out)
+    *out = s_nmea.stats;
+}
+
+void gps_ubx_get_stats(ubx_stats_t *out)
+{
+  if (out)
+    *out = s_ubx.stats;
+}
+
+// Publish the merged fix, feed the predictor and tell waiters (power manager)
+static void gps_signal_fix(void)
+{
+  msg_bus_publish_fix(&s_fix);
+  nav_predict_update(&s_fix);
+  if (!eg_system)
+    return;
+  xEventGroupSetBits(eg_system, EG_GPS_FIX);
+  if (timebase_pps_locked())
+    xEventGroupSetBits(eg_system, EG_PPS_LOCK);
+  else
+    xEventGroupClearBits(eg_system, EG_PPS_LOCK);
+}
+
+static void gps_on_rmc(const nmea_rmc_t *r, TickType_t *last_report)
+{
+  // discipline clock whenever we have a valid RMC
+  if (r->valid)
+  {
+    timebase_set_utc_from_rmc(r->hh, r->mm, r->ss, r->ms, r->day, r->mon, r->yy);
+    s_fix.unix_time = timebase_utc_now();
+  }
+  s_fix.fix_valid = r->valid && r->have_ll;
+  if (r->have_ll)
   {
-    xTaskCreate(gps_monitor_task, "gpsmon", 1024, NULL, tskIDLE_PRIORITY + 2, &s_mon_task);
+    s_fix.lat_e7 = r->lat_e7;
+    s_fix.lon_e7 = r->lon_e7;
+  }
+  if (s_fix.fix_valid)
+    gps_signal_fix();
+
+  if (xTaskGetTickCount() - *last_report > pdMS_TO_TICKS(1000))
+  {
+    *last_report = xTaskGetTickCount();
+    if (r->valid && r->have_ll)
+    {
+      LOGI("[RMC] A @ %02u:%02u:%02u lat=" E7_FMT " lon=" E7_FMT,
+           r->hh, r->mm, r->ss, E7_ARG(r->lat_e7), E7_ARG(r->lon_e7));
+    }
+    else
+      LOGI("[RMC] V (no fix yet)");
   }
 }
 
-// ---------- NMEA parse helpers ----------
-static int split_csv(char *s, char *fields[], int maxf)
+static void gps_on_gga(const nmea_gga_t *g, TickType_t *last_report)
 {
-  int n = 0;
-  char *p = s;
-  while (n < maxf && p && *p)
+  s_fix.sats = g->sats;
+  s_fix.hdop_x100 = g->hdop_x100;
+  if (g->fix)
+    s_fix.alt_cm = g->alt_cm;
+
+  if (xTaskGetTickCount() - *last_report > pdMS_TO_TICKS(1000))
   {
-    fields[n++] = p;
-    char *c = strchr(p, ',');
-    if (!c)
-      break;
-    *c = 0;
-    p = c + 1;
+    *last_report = xTaskGetTickCount();
+    LOGI("[GGA] fix=%u sats=%u hdop=%u.%02u alt=%ld.%02ldm%s%s",
+         g->fix, g->sats, g->hdop_x100 / 100u, g->hdop_x100 % 100u,
+         (long)(g->alt_cm / 100), labs((long)(g->alt_cm % 100)),
+         g->have_ll ? "" : " (no lat/lon)",
+         g->fix == 0 ? " (searching)" : "");
   }
-  return n;
 }
-static int to_int(const char *s) { return (s && *s) ? atoi(s) : 0; }
-static float to_float(const char *s) { return (s && *s) ? (float)atof(s) : 0.f; }
 
-static bool parse_latlon_dm(const char *lat, const char *latH, const char *lon, const char *lonH,
-                            double *outLatDeg, double *outLonDeg)
+static void gps_on_nav_pvt(const ubx_nav_pvt_t *v, TickType_t *last_report)
 {
-  if (!lat || !*lat || !lon || !*lon || !latH || !*latH || !lonH || !*lonH)
-    return false;
-  // lat: DDMM.mmmm, lon: DDDMM.mmmm
-  double lat_d = floor(atof(lat) / 100.0);
-  double lat_m = atof(lat) - lat_d * 100.0;
-  double lon_d = floor(atof(lon) / 100.0);
-  double lon_m = atof(lon) - lon_d * 100.0;
-  double lat_deg = lat_d + lat_m / 60.0;
-  double lon_deg = lon_d + lon_m / 60.0;
-  if (latH[0] == 'S')
-    lat_deg = -lat_deg;
-  if (lonH[0] == 'W')
-    lon_deg = -lon_deg;
-  if (outLatDeg)
-    *outLatDeg = lat_deg;
-  if (outLonDeg)
-    *outLonDeg = lon_deg;
-  return true;
-}
+  // validDate | validTime | fullyResolved
+  if ((v->valid & 0x07) == 0x07)
+  {
+    // PVT epochs sit on the second; only a near-zero fraction may bind to PPS
+    int ms = (v->nano > -500000 && v->nano < 500000) ? 0 : (int)(v->nano / 1000000);
+    if (ms >= 0)
+    {
+      timebase_set_utc_from_rmc(v->hour, v->min, v->sec, ms, v->day, v->month, v->year % 100);
+      s_fix.unix_time = timebase_utc_now();
+    }
+  }
 
-// keep your existing nmea_checksum_ok() helper
+  bool time_ok = (v->valid & 0x07) == 0x07;
+  bool ok = (v->flags & 0x01) && (v->fix_type == 2 || v->fix_type == 3);
+  s_fix.fix_valid = ok;
+  s_fix.sats = v->num_sv;
+  s_fix.hdop_x100 = v->pdop_x100; // PVT only reports pDOP
+  if (ok)
+  {
+    s_fix.lat_e7 = v->lat_e7;
+    s_fix.lon_e7 = v->lon_e7;
+    s_fix.alt_cm = v->hmsl_mm / 10;
+    if (time_ok)
+      gps_signal_fix();
+  }
 
-// ---------- Clean monitor task ----------
-static TaskHandle_t s_mon_task;
+  if (xTaskGetTickCount() - *last_report > pdMS_TO_TICKS(1000))
+  {
+    *last_report = xTaskGetTickCount();
+    if (ok)
+    {
+      LOGI("[PVT] %uD @ %02u:%02u:%02u sv=%u lat=" E7_FMT " lon=" E7_FMT " alt=%ldm",
+           v->fix_type, v->hour, v->min, v->sec, v->num_sv,
+           E7_ARG(v->lat_e7), E7_ARG(v->lon_e7), (long)(v->hmsl_mm / 1000));
+    }
+    else
+      LOGI("[PVT] no fix yet (sv=%u)", v->num_sv);
+  }
+}
 
 static void gps_monitor_task(void *arg)
 {
   (void)arg;
   LOGI("gps: monitor task started");
-  vTaskDelay(pdMS_TO_TICKS(200)); // settle
 
-  char line[160];
-  size_t idx = 0;
-  uint32_t last_report = 0;
+  nmea_init(&s_nmea);
+  ubx_init(&s_ubx);
+  TickType_t last_report = 0;
 
   for (;;)
   {
-    while (uart_is_readable(UART_GPS_ID))
+    // Sleep until the IRQ sees end-of-line / RX idle (or the ring fills past half).
+    // The timeout only bounds latency if the module goes quiet mid-frame.
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+
+    uint8_t c;
+    while (gps_rx_pop(&c))
     {
-      char c = uart_getc(UART_GPS_ID);
-      if (c == '\r')
-        continue;
-      if (c == '\n' || idx >= sizeof(line) - 1)
+      if (c == '\n')
+        s_rx_stats.lines++;
+
+      // NMEA and UBX share the stream; each parser ignores the other's bytes
+      if (ubx_feed(&s_ubx, c))
       {
-        line[idx] = 0;
-        idx = 0;
-
-        if (line[0] == '$' && nmea_checksum_ok(line))
-        {
-          // make a working copy after '*'
-          char buf[160];
-          // copy up to but not including '*'
-          char *star = strchr(line, '*');
-          size_t ncopy = (star && (size_t)(star - line) < sizeof(buf) - 1) ? (size_t)(star - line) : strlen(line);
-          memcpy(buf, line, ncopy);
-          buf[ncopy] = 0;
-
-          // identify sentence
-          const char *id = buf + 1; // skip '$'
-          char *fields[32];
-          int nf = split_csv(buf + 7, fields, 32); // after "$GxXXX,"
-          // ids: GPRMC/GNRMC, GPGGA/GNGGA
-          if (!strncmp(id, "GPRMC", 5) || !strncmp(id, "GNRMC", 5))
-          {
-            // RMC: time, status, lat, N/S, lon, E/W, speed(kn), course, date, ...
-            // fields[0]=hhmmss.sss, 1=status(A/V), 2=lat,3=N/S,4=lon,5=E/W, 6=speed,7=course,8=ddmmyy
-            const char *t = fields[0];
-            const char *st = fields[1];
-
-            // parse h,m,s,ms
-            int hh = 0, mm = 0, ss = 0, ms = 0;
-            if (t && strlen(t) >= 6)
-            {
-              hh = (t[0] - '0') * 10 + (t[1] - '0');
-              mm = (t[2] - '0') * 10 + (t[3] - '0');
-              ss = (t[4] - '0') * 10 + (t[5] - '0');
-              const char *dot = strchr(t, '.');
-              if (dot && dot[1])
-              {
-                // take 3 digits of fractional seconds (pad as needed)
-                int d1 = dot[1] ? dot[1] - '0' : 0;
-                int d2 = dot[2] ? dot[2] - '0' : 0;
-                int d3 = dot[3] ? dot[3] - '0' : 0;
-                ms = d1 * 100 + d2 * 10 + d3;
-              }
-            }
-
-            // parse ddmmyy
-            int dd = 1, mo = 1, yy = 0;
-            if (nf > 8 && fields[8] && strlen(fields[8]) == 6)
-            {
-              const char *dmy = fields[8];
-              dd = (dmy[0] - '0') * 10 + (dmy[1] - '0');
-              mo = (dmy[2] - '0') * 10 + (dmy[3] - '0');
-              yy = (dmy[4] - '0') * 10 + (dmy[5] - '0');
-            }
-
-            bool valid = (st && *st == 'A');
-
-            // discipline clock whenever we have a valid RMC
-            if (valid)
-            {
-              timebase_set_utc_from_rmc(hh, mm, ss, dd, mo, yy);
-            }
-
-            double latd = 0, lond = 0;
-            bool have_ll = false;
-            if (nf > 5)
-              have_ll = parse_latlon_dm(fields[2], fields[3], fields[4], fields[5], &latd, &lond);
-            if (xTaskGetTickCount() - last_report > pdMS_TO_TICKS(1000))
-            {
-              last_report = xTaskGetTickCount();
-              if (valid && have_ll) {
-                LOGI("[RMC] %c @ %c%c:%c%c:%c%c lat=%.6f lon=%.6f",
-                     'A',
-                     t ? t[0] : '?', t ? t[1] : '?', t ? t[2] : '?', t ? t[3] : '?',
-                     t ? t[4] : '?', t ? t[5] : '?', t ? t[6] : '?', latd, lond);
-                // Optional: only update when you cross into a new 4-char grid
-                static char last_grid[5] = "";
-                char g[5];
-                // compute current grid
-                {
-                  extern void wspr_update_grid_from_latlon(double lat, double lon);
-                  // small helper: reuse the same converter here or expose a getter
-                  // For simplicity, call the encoder API:
-                  wspr_update_grid_from_latlon(latd, lond); // sets internal cfg.grid
-                }
-                // if you want to log the change, you can recompute and compare,
-                // or expose a wspr_get_grid() function. Minimal version:
-                LOGI("[WSPR] grid updated from GPS");
-
-              }
-              else LOGI("[RMC] V (no fix yet)");
-            }
-          }
-          else if (!strncmp(id, "GPGGA", 5) || !strncmp(id, "GNGGA", 5))
-          {
-            // GGA: time, lat, N/S, lon, E/W, fix(0/1/2), sats, HDOP, alt(m), …
-            double latd = 0, lond = 0;
-            bool have_ll = false;
-            int fix = 0, sats = 0;
-            float hdop = 0, alt = 0;
-            if (nf >= 9)
-            {
-              have_ll = parse_latlon_dm(fields[1], fields[2], fields[3], fields[4], &latd, &lond);
-              fix = to_int(fields[5]);
-              sats = to_int(fields[6]);
-              hdop = to_float(fields[7]);
-              alt = to_float(fields[8]);
-            }
-            if (xTaskGetTickCount() - last_report > pdMS_TO_TICKS(1000))
-            {
-              last_report = xTaskGetTickCount();
-              LOGI("[GGA] fix=%d sats=%d hdop=%.1f alt=%.1fm%s%s",
-                   fix, sats, hdop, alt,
-                   have_ll ? "" : " (no lat/lon)",
-                   fix == 0 ? " (searching)" : "");
-            }
-          }
-          else if (!strncmp(id, "GNZDA", 5) || !strncmp(id, "GPZDA", 5))
-          {
-            // Optional: time/date from ZDA
-          }
-          else if (strstr(line, "ANTENNA OPEN"))
-          {
-            LOGW("[GPS] ANTENNA OPEN (check antenna/connectors)");
-          }
-        }
-        // else drop bad checksum lines silently
+        ubx_nav_pvt_t pvt;
+        if (s_ubx.cls == UBX_CLS_ACK)
+          gps_on_ack(&s_ubx);
+        else if (ubx_decode_nav_pvt(&s_ubx, &pvt))
+          gps_on_nav_pvt(&pvt, &last_report);
+        continue;
       }
-      else
+
+      switch (nmea_feed(&s_nmea, (char)c))
       {
-        line[idx++] = c;
+      case NMEA_EV_RMC:
+        gps_on_rmc(&s_nmea.rmc, &last_report);
+        break;
+      case NMEA_EV_GGA:
+        gps_on_gga(&s_nmea.gga, &last_report);
+        break;
+      case NMEA_EV_ANTENNA_OPEN:
+        LOGW("[GPS] ANTENNA OPEN (check antenna/connectors)");
+        break;
+      default:
+        break; // bad checksum / uninteresting sentences are dropped silently
       }
     }
-    vTaskDelay(pdMS_TO_TICKS(10));
   }
-}
\ No newline at end of file
+}
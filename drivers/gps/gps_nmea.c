@@ -0,0 +1,380 @@
+#include "gps_nmea.h"
+#include <string.h>
+
+enum { ST_IDLE = 0, ST_HDR, ST_BODY, ST_CK1, ST_CK2 };
+enum { SEN_NONE = 0, SEN_RMC, SEN_GGA, SEN_TXT };
+
+// lat/lon bookkeeping: have_ll only if all four fields were present
+#define LL_LAT 0x01
+#define LL_NS  0x02
+#define LL_LON 0x04
+#define LL_EW  0x08
+#define LL_ALL 0x0F
+
+static const char k_ant_open[] = "ANTENNA OPEN";
+
+void nmea_init(nmea_parser_t *p)
+{
+  memset(p, 0, sizeof(*p));
+}
+
+static uint8_t hexval(char c) { return (c >= '0' && c <= '9')   ? (uint8_t)(c - '0')
+                                       : (c >= 'A' && c <= 'F') ? (uint8_t)(10 + c - 'A')
+                                       : (c >= 'a' && c <= 'f') ? (uint8_t)(10 + c - 'a')
+                                                                : 0xFF; }
+
+// "$TTSSS": any talker, we only care about the 3-char sentence ID
+static uint8_t classify(const char hdr[5])
+{
+  if (hdr[2] == 'R' && hdr[3] == 'M' && hdr[4] == 'C') return SEN_RMC;
+  if (hdr[2] == 'G' && hdr[3] == 'G' && hdr[4] == 'A') return SEN_GGA;
+  if (hdr[2] == 'T' && hdr[3] == 'X' && hdr[4] == 'T') return SEN_TXT;
+  return SEN_NONE;
+}
+
+// Fractional digits kept per field (extra digits are truncated). 0 = integer/text.
+static uint8_t field_frac(uint8_t sen, uint8_t f)
+{
+  if (sen == SEN_RMC)
+  {
+    // 0=hhmmss.sss 1=status 2=lat 3=N/S 4=lon 5=E/W 6=speed(kn) 7=course 8=ddmmyy
+    switch (f) { case 0: return 3; case 2: case 4: return 5; case 6: return 3; case 7: return 2; }
+  }
+  else if (sen == SEN_GGA)
+  {
+    // 0=time 1=lat 2=N/S 3=lon 4=E/W 5=fix 6=sats 7=hdop 8=alt(m)
+    switch (f) { case 0: return 3; case 1: case 3: return 5; case 7: return 2; case 8: return 2; }
+  }
+  return 0;
+}
+
+// Field value scaled to exactly `want` fractional digits
+static uint32_t fx_value(const nmea_parser_t *p, uint8_t want)
+{
+  uint32_t v = p->acc;
+  for (uint8_t i = p->frac; i < want; i++)
+    v *= 10u;
+  return v;
+}
+
+// (D)DDMM.mmmmm scaled by 1e5 -> degrees * 1e7. Returns false on nonsense.
+static bool dm_to_e7(uint32_t v, uint32_t max_deg, int32_t *out)
+{
+  uint32_t deg = v / 10000000u;
+  uint32_t min_e5 = v % 10000000u;
+  if (deg > max_deg || min_e5 >= 6000000u)
+    return false;
+  *out = (int32_t)(deg * 10000000u + (min_e5 * 100u + 30u) / 60u);
+  return true;
+}
+
+// hhmmss.sss scaled by 1e3
+static void hms_from(uint32_t v, uint8_t *hh, uint8_t *mm, uint8_t *ss, uint16_t *ms)
+{
+  *ms = (uint16_t)(v % 1000u); v /= 1000u;
+  *ss = (uint8_t)(v % 100u);   v /= 100u;
+  *mm = (uint8_t)(v % 100u);   v /= 100u;
+  *hh = (uint8_t)(v % 100u);
+}
+
+static void field_begin(nmea_parser_t *p)
+{
+  p->acc = 0;
+  p->frac = 0;
+  p->nch = 0;
+  p->dot = false;
+  p->neg = false;
+  p->ovf = false;
+  p->ch0 = 0;
+  p->fmax = field_frac(p->sentence, p->field);
+}
+
+static void field_char(nmea_parser_t *p, char c)
+{
+  if (p->nch++ == 0)
+    p->ch0 = c;
+
+  if (p->sentence == SEN_TXT)
+  {
+    // field 3 is the free text; prefix-match it against "ANTENNA OPEN"
+    if (p->field == 3 && p->txt_match == p->nch - 1 &&
+        p->txt_match < sizeof(k_ant_open) - 1 && k_ant_open[p->txt_match] == c)
+      p->txt_match++;
+    return;
+  }
+
+  if (c >= '0' && c <= '9')
+  {
+    if (p->dot)
+    {
+      if (p->frac >= p->fmax)
+        return;
+      p->frac++;
+    }
+    if (p->acc > 429496728u) // next *10+9 would wrap
+    {
+      p->ovf = true;
+      return;
+    }
+    p->acc = p->acc * 10u + (uint32_t)(c - '0');
+  }
+  else if (c == '.')
+    p->dot = true;
+  else if (c == '-')
+    p->neg = true;
+}
+
+static void field_end_rmc(nmea_parser_t *p, bool empty)
+{
+  nmea_rmc_t *r = &p->rmc;
+  switch (p->field)
+  {
+  case 0:
+    if (!empty && p->nch >= 6)
+      hms_from(fx_value(p, 3), &r->hh, &r->mm, &r->ss, &r->ms);
+    break;
+  case 1:
+    r->valid = (p->ch0 == 'A');
+    break;
+  case 2:
+    if (!empty && dm_to_e7(fx_value(p, 5), 90, &r->lat_e7))
+      p->ll_fields |= LL_LAT;
+    break;
+  case 3:
+    if (p->ch0 == 'N' || p->ch0 == 'S')
+    {
+      if (p->ch0 == 'S')
+        r->lat_e7 = -r->lat_e7;
+      p->ll_fields |= LL_NS;
+    }
+    break;
+  case 4:
+    if (!empty && dm_to_e7(fx_value(p, 5), 180, &r->lon_e7))
+      p->ll_fields |= LL_LON;
+    break;
+  case 5:
+    if (p->ch0 == 'E' || p->ch0 == 'W')
+    {
+      if (p->ch0 == 'W')
+        r->lon_e7 = -r->lon_e7;
+      p->ll_fields |= LL_EW;
+    }
+    break;
+  case 6:
+    // milli-knots -> cm/s (1 kn = 51.444 cm/s)
+    if (!empty)
+    {
+      uint32_t mkn = fx_value(p, 3);
+      if (mkn < 3000000u)
+        r->speed_cms = (mkn * 1286u + 12500u) / 25000u;
+    }
+    break;
+  case 7:
+    if (!empty)
+      r->course_cdeg = fx_value(p, 2);
+    break;
+  case 8:
+    if (!empty && p->nch == 6)
+    {
+      r->day = (uint8_t)(p->acc / 10000u);
+      r->mon = (uint8_t)(p->acc / 100u % 100u);
+      r->yy = (uint8_t)(p->acc % 100u);
+    }
+    break;
+  }
+}
+
+static void field_end_gga(nmea_parser_t *p, bool empty)
+{
+  nmea_gga_t *g = &p->gga;
+  switch (p->field)
+  {
+  case 0:
+    if (!empty && p->nch >= 6)
+      hms_from(fx_value(p, 3), &g->hh, &g->mm, &g->ss, &g->ms);
+    break;
+  case 1:
+    if (!empty && dm_to_e7(fx_value(p, 5), 90, &g->lat_e7))
+      p->ll_fields |= LL_LAT;
+    break;
+  case 2:
+    if (p->ch0 == 'N' || p->ch0 == 'S')
+    {
+      if (p->ch0 == 'S')
+        g->lat_e7 = -g->lat_e7;
+      p->ll_fields |= LL_NS;
+    }
+    break;
+  case 3:
+    if (!empty && dm_to_e7(fx_value(p, 5), 180, &g->lon_e7))
+      p->ll_fields |= LL_LON;
+    break;
+  case 4:
+    if (p->ch0 == 'E' || p->ch0 == 'W')
+    {
+      if (p->ch0 == 'W')
+        g->lon_e7 = -g->lon_e7;
+      p->ll_fields |= LL_EW;
+    }
+    break;
+  case 5:
+    if (!empty)
+      g->fix = (uint8_t)p->acc;
+    break;
+  case 6:
+    if (!empty)
+      g->sats = (uint8_t)p->acc;
+    break;
+  case 7:
+    if (!empty)
+    {
+      uint32_t h = fx_value(p, 2);
+      g->hdop_x100 = (uint16_t)(h < 65535u ? h : 65535u);
+    }
+    break;
+  case 8:
+    if (!empty)
+    {
+      int32_t cm = (int32_t)fx_value(p, 2);
+      g->alt_cm = p->neg ? -cm : cm;
+    }
+    break;
+  }
+}
+
+static void field_end(nmea_parser_t *p)
+{
+  bool empty = (p->nch == 0) || p->ovf;
+  if (p->sentence == SEN_RMC)
+    field_end_rmc(p, empty);
+  else if (p->sentence == SEN_GGA)
+    field_end_gga(p, empty);
+}
+
+static nmea_event_t sentence_done(nmea_parser_t *p)
+{
+  p->stats.sentences++;
+  switch (p->sentence)
+  {
+  case SEN_RMC:
+    p->rmc.have_ll = (p->ll_fields == LL_ALL);
+    return NMEA_EV_RMC;
+  case SEN_GGA:
+    p->gga.have_ll = (p->ll_fields == LL_ALL);
+    return NMEA_EV_GGA;
+  case SEN_TXT:
+    if (p->txt_match == sizeof(k_ant_open) - 1)
+      return NMEA_EV_ANTENNA_OPEN;
+    break;
+  }
+  return NMEA_EV_NONE;
+}
+
+nmea_event_t nmea_feed(nmea_parser_t *p, char c)
+{
+  if (c == '$')
+  {
+    // always resync on a start char, even mid-sentence
+    p->state = ST_HDR;
+    p->len = 0;
+    p->cksum = 0;
+    return NMEA_EV_NONE;
+  }
+
+  switch (p->state)
+  {
+  case ST_HDR:
+    p->cksum ^= (uint8_t)c;
+    if (p->len < 5)
+    {
+      p->hdr[p->len++] = c;
+      if (p->len < 5)
+        return NMEA_EV_NONE;
+      // "$TTSSS" complete: decide now whether the rest is worth reading
+      p->sentence = classify(p->hdr);
+      if (p->sentence == SEN_NONE)
+      {
+        p->stats.rejected++;
+        p->state = ST_IDLE;
+        return NMEA_EV_NONE;
+      }
+      if (p->sentence == SEN_RMC)
+        memset(&p->rmc, 0, sizeof(p->rmc));
+      else if (p->sentence == SEN_GGA)
+        memset(&p->gga, 0, sizeof(p->gga));
+      p->ll_fields = 0;
+      p->txt_match = 0;
+      return NMEA_EV_NONE;
+    }
+    if (c != ',')
+    {
+      p->state = ST_IDLE;
+      return NMEA_EV_NONE;
+    }
+    p->len++;
+    p->field = 0;
+    field_begin(p);
+    p->state = ST_BODY;
+    return NMEA_EV_NONE;
+
+  case ST_BODY:
+    if (++p->len > NMEA_MAX_LEN)
+    {
+      p->stats.overlong++;
+      p->state = ST_IDLE;
+      return NMEA_EV_NONE;
+    }
+    if (c == '*')
+    {
+      field_end(p);
+      p->state = ST_CK1;
+      return NMEA_EV_NONE;
+    }
+    if (c == '\r' || c == '\n')
+    {
+      // line ended without a checksum: not trustworthy
+      p->stats.bad_checksum++;
+      p->state = ST_IDLE;
+      return NMEA_EV_NONE;
+    }
+    p->cksum ^= (uint8_t)c;
+    if (c == ',')
+    {
+      field_end(p);
+      p->field++;
+      field_begin(p);
+      return NMEA_EV_NONE;
+    }
+    field_char(p, c);
+    return NMEA_EV_NONE;
+
+  case ST_CK1:
+  {
+    uint8_t h = hexval(c);
+    if (h > 0x0F)
+    {
+      p->stats.bad_checksum++;
+      p->state = ST_IDLE;
+      return NMEA_EV_NONE;
+    }
+    p->ck_rx = (uint8_t)(h << 4);
+    p->state = ST_CK2;
+    return NMEA_EV_NONE;
+  }
+
+  case ST_CK2:
+  {
+    uint8_t h = hexval(c);
+    p->state = ST_IDLE;
+    if (h > 0x0F || (uint8_t)(p->ck_rx | h) != p->cksum)
+    {
+      p->stats.bad_checksum++;
+      return NMEA_EV_NONE;
+    }
+    return sentence_done(p);
+  }
+
+  default:
+    return NMEA_EV_NONE;
+  }
+}
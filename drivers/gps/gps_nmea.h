@@ -0,0 +1,80 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// Single-pass NMEA tokenizer: feed one byte at a time straight from the RX ring.
+// Checksum, field split and numeric conversion all happen as bytes arrive, so
+// there are no line buffers and no float math. Only RMC, GGA and TXT are kept;
+// every other sentence ID is dropped as soon as its 6-byte "$TTSSS" header is in.
+
+#define NMEA_MAX_LEN 100   // spec says 82; anything longer than this is garbage
+
+typedef enum {
+  NMEA_EV_NONE = 0,
+  NMEA_EV_RMC,            // p->rmc is complete and checksum-verified
+  NMEA_EV_GGA,            // p->gga is complete and checksum-verified
+  NMEA_EV_ANTENNA_OPEN,   // $xxTXT carrying "ANTENNA OPEN"
+} nmea_event_t;
+
+typedef struct {
+  uint8_t  hh, mm, ss;
+  uint16_t ms;
+  uint8_t  day, mon, yy;  // yy = 00..99
+  bool     valid;         // status 'A'
+  bool     have_ll;
+  int32_t  lat_e7;        // degrees * 1e7
+  int32_t  lon_e7;
+  uint32_t speed_cms;     // ground speed, cm/s
+  uint32_t course_cdeg;   // course over ground, 0.01 deg
+} nmea_rmc_t;
+
+typedef struct {
+  uint8_t  hh, mm, ss;
+  uint16_t ms;
+  bool     have_ll;
+  int32_t  lat_e7;
+  int32_t  lon_e7;
+  uint8_t  fix;           // 0 = none, 1 = GPS, 2 = DGPS, ...
+  uint8_t  sats;
+  uint16_t hdop_x100;
+  int32_t  alt_cm;        // MSL altitude
+} nmea_gga_t;
+
+typedef struct {
+  uint32_t sentences;     // good sentences we parsed (RMC/GGA/TXT)
+  uint32_t rejected;      // sentence IDs we skipped after the header
+  uint32_t bad_checksum;
+  uint32_t overlong;      // no '*' within NMEA_MAX_LEN
+} nmea_stats_t;
+
+typedef struct {
+  // framing
+  uint8_t  state;
+  uint8_t  len;           // bytes since '$'
+  uint8_t  cksum;         // running XOR
+  uint8_t  ck_rx;         // received checksum (hex)
+  uint8_t  sentence;      // which sentence we're filling
+  uint8_t  field;         // field index after the header
+  char     hdr[5];        // talker + sentence ID
+
+  // current field accumulator (fixed point: value = acc / 10^frac)
+  uint32_t acc;
+  uint8_t  frac;
+  uint8_t  fmax;          // fractional digits this field keeps
+  uint8_t  nch;           // chars seen in this field
+  bool     dot;
+  bool     neg;
+  bool     ovf;
+  char     ch0;           // first char (status/hemisphere fields)
+
+  // per-sentence scratch
+  uint8_t  ll_fields;     // bitmask of lat/lon/hemisphere fields seen
+  uint8_t  txt_match;     // progress matching "ANTENNA OPEN"
+
+  nmea_rmc_t   rmc;
+  nmea_gga_t   gga;
+  nmea_stats_t stats;
+} nmea_parser_t;
+
+void         nmea_init(nmea_parser_t *p);
+nmea_event_t nmea_feed(nmea_parser_t *p, char c);
@@ -0,0 +1,137 @@
+#include "gps_nmea_replay.h"
+#include <string.h>
+
+// Expected decode for one corpus line. ev = NMEA_EV_NONE means the parser
+// must produce nothing for it (skipped, corrupted, truncated, overlong).
+typedef struct {
+  const char  *line;
+  nmea_event_t ev;
+  bool         valid;     // RMC status / GGA fix > 0
+  bool         have_ll;
+  int32_t      lat_e7, lon_e7;
+  int32_t      alt_cm;    // GGA only
+  uint32_t     speed_cms; // RMC only
+  uint8_t      sats;      // GGA only
+  uint16_t     hdop_x100; // GGA only
+} replay_case_t;
+
+// Hand-written in the formats a u-blox M8 emits (field widths, talker IDs),
+// with valid checksums; not recorded from a receiver
+static const replay_case_t k_corpus[] = {
+  // ground level
+  { "$GNRMC,123519.00,A,4807.03812,N,01131.00000,E,0.022,,230394,,,A*6D\r\n",
+    NMEA_EV_RMC, true, true, 481173020, 115166667, 0, 1, 0, 0 },
+  { "$GNGGA,123519.00,4807.03812,N,01131.00000,E,1,09,0.92,545.4,M,46.9,M,,*47\r\n",
+    NMEA_EV_GGA, true, true, 481173020, 115166667, 54540, 0, 9, 92 },
+  { "$GNGSA,A,3,05,13,15,18,20,24,,,,,,,1.65,0.92,1.37*1E\r\n", NMEA_EV_NONE },
+  { "$GPGSV,3,1,11,05,56,295,32,13,38,067,29,15,73,150,35,18,21,174,22*7B\r\n", NMEA_EV_NONE },
+  { "$GNVTG,,T,,M,0.022,N,0.041,K,A*38\r\n", NMEA_EV_NONE },
+
+  // flight: southern/western hemisphere, 32 km, then a negative altitude
+  { "$GPRMC,021733.40,A,3352.12845,S,15112.43917,W,48.731,87.40,170826,,,A*6A\r\n",
+    NMEA_EV_RMC, true, true, -338688075, -1512073195, 0, 2507, 0, 0 },
+  { "$GPGGA,021733.40,3352.12845,S,15112.43917,W,1,11,0.71,32458.7,M,22.1,M,,*58\r\n",
+    NMEA_EV_GGA, true, true, -338688075, -1512073195, 3245870, 0, 11, 71 },
+  { "$GPGGA,021734.40,3352.13012,S,15112.41108,W,1,11,0.72,-12.50,M,22.1,M,,*77\r\n",
+    NMEA_EV_GGA, true, true, -338688353, -1512068513, -1250, 0, 11, 72 },
+
+  // corrupted checksum
+  { "$GPRMC,021735.40,A,3352.13177,S,15112.38299,W,48.612,87.31,170826,,,A*38\r\n", NMEA_EV_NONE },
+  // longer than NMEA_MAX_LEN
+  { "$GPGGA,1234.56789,1234.56789,1234.56789,1234.56789,1234.56789,1234.56789,"
+    "1234.56789,1234.56789,1234.56789,1234.56789,1234.56789,1234.56789*56\r\n", NMEA_EV_NONE },
+  // cut off mid-field (receiver reset / power cycle)
+  { "$GPRMC,021736.40,A,3352.13\r\n", NMEA_EV_NONE },
+
+  // cold start: no fix yet, then the antenna warning
+  { "$GPRMC,000012.00,V,,,,,,,060180,,,N*71\r\n", NMEA_EV_RMC, false, false },
+  { "$GPTXT,01,01,01,ANTENNA OPEN*25\r\n", NMEA_EV_ANTENNA_OPEN },
+};
+
+#define N_CORPUS (sizeof(k_corpus) / sizeof(k_corpus[0]))
+
+// What one pass of the corpus must leave in nmea_stats_t
+#define EXP_SENTENCES    7
+#define EXP_REJECTED     3
+#define EXP_BAD_CHECKSUM 2
+#define EXP_OVERLONG     1
+
+static void check(nmea_replay_result_t *r, bool ok)
+{
+  r->checks++;
+  if (!ok)
+    r->failures++;
+}
+
+static void check_case(nmea_replay_result_t *r, const nmea_parser_t *p,
+                       const replay_case_t *c, nmea_event_t got)
+{
+  check(r, got == c->ev);
+  if (got != c->ev)
+    return;
+  if (got == NMEA_EV_RMC)
+  {
+    const nmea_rmc_t *m = &p->rmc;
+    check(r, m->valid == c->valid);
+    check(r, m->have_ll == c->have_ll);
+    if (c->have_ll)
+    {
+      check(r, m->lat_e7 == c->lat_e7);
+      check(r, m->lon_e7 == c->lon_e7);
+      check(r, m->speed_cms == c->speed_cms);
+    }
+  }
+  else if (got == NMEA_EV_GGA)
+  {
+    const nmea_gga_t *g = &p->gga;
+    check(r, (g->fix > 0) == c->valid);
+    check(r, g->have_ll == c->have_ll);
+    check(r, g->lat_e7 == c->lat_e7);
+    check(r, g->lon_e7 == c->lon_e7);
+    check(r, g->alt_cm == c->alt_cm);
+    check(r, g->sats == c->sats);
+    check(r, g->hdop_x100 == c->hdop_x100);
+  }
+}
+
+void nmea_replay_run(uint32_t passes, uint64_t (*now_us)(void), nmea_replay_result_t *out)
+{
+  static nmea_parser_t p; // ~200 B; keep it off the caller's stack
+  memset(out, 0, sizeof(*out));
+  if (passes == 0)
+    passes = 1;
+  nmea_init(&p);
+
+  uint64_t t0 = now_us ? now_us() : 0;
+  for (uint32_t n = 0; n < passes; n++)
+  {
+    for (uint32_t i = 0; i < N_CORPUS; i++)
+    {
+      const replay_case_t *c = &k_corpus[i];
+      nmea_event_t last = NMEA_EV_NONE;
+      for (const char *s = c->line; *s; s++)
+      {
+        nmea_event_t ev = nmea_feed(&p, *s);
+        if (ev != NMEA_EV_NONE)
+        {
+          last = ev;
+          out->events++;
+        }
+        out->bytes++;
+      }
+      out->lines++;
+      if (n == 0)
+        check_case(out, &p, c, last);
+    }
+    if (n == 0)
+      out->stats = p.stats;
+  }
+  if (now_us)
+    out->elapsed_us = now_us() - t0;
+  out->passes = passes;
+
+  out->stats_ok = out->stats.sentences == EXP_SENTENCES &&
+                  out->stats.rejected == EXP_REJECTED &&
+                  out->stats.bad_checksum == EXP_BAD_CHECKSUM &&
+                  out->stats.overlong == EXP_OVERLONG;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "gps_nmea.h"
+
+// Replay a built-in corpus of receiver output through a private nmea_parser_t
+// and check every decoded RMC/GGA against known values. The corpus is
+// synthetic, in u-blox M8 format: a ground fix, a high-altitude
+// southern-western track, sentences we skip, a corrupted checksum, a truncated line and one longer than
+// NMEA_MAX_LEN. No UART, no heap: runs the same on target and on a host.
+
+typedef struct {
+  uint32_t passes;        // times the corpus was fed
+  uint32_t bytes;         // total bytes fed
+  uint32_t lines;         // total lines fed
+  uint32_t events;        // RMC/GGA/TXT events produced
+  uint64_t elapsed_us;    // wall time for all passes (0 if no clock given)
+  uint32_t checks;        // field comparisons made (first pass only)
+  uint32_t failures;      // comparisons that didn't match
+  nmea_stats_t stats;     // parser counters after the first pass
+  bool     stats_ok;      // counters match what the corpus should produce
+} nmea_replay_result_t;
+
+// now_us may be NULL (no timing). passes >= 1.
+void nmea_replay_run(uint32_t passes, uint64_t (*now_us)(void), nmea_replay_result_t *out);
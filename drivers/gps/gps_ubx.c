@@ -0,0 +1,141 @@
+#include "gps_ubx.h"
+#include <string.h>
+
+enum { ST_SYNC1 = 0, ST_SYNC2, ST_CLS, ST_ID, ST_LEN1, ST_LEN2, ST_PAYLOAD, ST_CKA, ST_CKB };
+
+void ubx_init(ubx_parser_t *p)
+{
+  memset(p, 0, sizeof(*p));
+}
+
+static inline void ck_add(uint8_t *a, uint8_t *b, uint8_t v)
+{
+  *a = (uint8_t)(*a + v);
+  *b = (uint8_t)(*b + *a);
+}
+
+bool ubx_feed(ubx_parser_t *p, uint8_t b)
+{
+  switch (p->state)
+  {
+  case ST_SYNC1:
+    if (b == UBX_SYNC1)
+      p->state = ST_SYNC2;
+    return false;
+  case ST_SYNC2:
+    p->state = (b == UBX_SYNC2) ? ST_CLS : (b == UBX_SYNC1 ? ST_SYNC2 : ST_SYNC1);
+    p->ck_a = p->ck_b = 0;
+    return false;
+  case ST_CLS:
+    p->cls = b;
+    ck_add(&p->ck_a, &p->ck_b, b);
+    p->state = ST_ID;
+    return false;
+  case ST_ID:
+    p->id = b;
+    ck_add(&p->ck_a, &p->ck_b, b);
+    p->state = ST_LEN1;
+    return false;
+  case ST_LEN1:
+    p->len = b;
+    ck_add(&p->ck_a, &p->ck_b, b);
+    p->state = ST_LEN2;
+    return false;
+  case ST_LEN2:
+    p->len |= (uint16_t)b << 8;
+    ck_add(&p->ck_a, &p->ck_b, b);
+    if (p->len > UBX_MAX_PAYLOAD)
+    {
+      p->stats.oversize++;
+      p->state = ST_SYNC1; // resync; anything we'd want fits the buffer
+      return false;
+    }
+    p->idx = 0;
+    p->state = p->len ? ST_PAYLOAD : ST_CKA;
+    return false;
+  case ST_PAYLOAD:
+    p->payload[p->idx++] = b;
+    ck_add(&p->ck_a, &p->ck_b, b);
+    if (p->idx >= p->len)
+      p->state = ST_CKA;
+    return false;
+  case ST_CKA:
+    if (b != p->ck_a)
+    {
+      p->stats.bad_checksum++;
+      p->state = (b == UBX_SYNC1) ? ST_SYNC2 : ST_SYNC1;
+      return false;
+    }
+    p->state = ST_CKB;
+    return false;
+  case ST_CKB:
+    p->state = ST_SYNC1;
+    if (b != p->ck_b)
+    {
+      p->stats.bad_checksum++;
+      return false;
+    }
+    p->stats.frames++;
+    return true;
+  default:
+    p->state = ST_SYNC1;
+    return false;
+  }
+}
+
+uint16_t ubx_frame(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len,
+                   uint8_t *out, uint16_t out_size)
+{
+  if (!out || out_size < (uint32_t)len + UBX_OVERHEAD || (len && !payload))
+    return 0;
+  uint8_t a = 0, b = 0;
+  out[0] = UBX_SYNC1;
+  out[1] = UBX_SYNC2;
+  out[2] = cls;
+  out[3] = id;
+  out[4] = (uint8_t)(len & 0xFF);
+  out[5] = (uint8_t)(len >> 8);
+  if (len)
+    memcpy(&out[6], payload, len);
+  for (uint16_t i = 2; i < 6u + len; i++)
+    ck_add(&a, &b, out[i]);
+  out[6 + len] = a;
+  out[7 + len] = b;
+  return (uint16_t)(len + UBX_OVERHEAD);
+}
+
+// little-endian readers (payload is byte-aligned)
+static inline uint16_t rd_u16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static inline uint32_t rd_u32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+static inline int32_t rd_i32(const uint8_t *p) { return (int32_t)rd_u32(p); }
+
+bool ubx_decode_nav_pvt(const ubx_parser_t *p, ubx_nav_pvt_t *out)
+{
+  if (p->cls != UBX_CLS_NAV || p->id != UBX_NAV_PVT || p->len < UBX_NAV_PVT_LEN || !out)
+    return false;
+  const uint8_t *d = p->payload;
+  out->year = rd_u16(d + 4);
+  out->month = d[6];
+  out->day = d[7];
+  out->hour = d[8];
+  out->min = d[9];
+  out->sec = d[10];
+  out->valid = d[11];
+  out->nano = rd_i32(d + 16);
+  out->fix_type = d[20];
+  out->flags = d[21];
+  out->num_sv = d[23];
+  out->lon_e7 = rd_i32(d + 24);
+  out->lat_e7 = rd_i32(d + 28);
+  out->hmsl_mm = rd_i32(d + 36);
+  out->hacc_mm = rd_u32(d + 40);
+  out->vel_n_mms = rd_i32(d + 48);
+  out->vel_e_mms = rd_i32(d + 52);
+  out->vel_d_mms = rd_i32(d + 56);
+  out->gspeed_mms = rd_i32(d + 60);
+  out->pdop_x100 = rd_u16(d + 76);
+  return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// UBX framing + byte-at-a-time receiver. Frame on the wire:
+//   0xB5 0x62 | class | id | len (LE u16) | payload | CK_A CK_B
+// CK_A/CK_B are an 8-bit Fletcher sum over class..payload.
+
+#define UBX_SYNC1 0xB5
+#define UBX_SYNC2 0x62
+#define UBX_OVERHEAD 8           // sync(2) + class/id(2) + len(2) + ck(2)
+#define UBX_MAX_PAYLOAD 100      // NAV-PVT is 92; config replies are smaller
+
+#define UBX_CLS_NAV 0x01
+#define UBX_CLS_ACK 0x05
+#define UBX_CLS_CFG 0x06
+#define UBX_CLS_NMEA 0xF0        // for CFG-MSG rates on standard NMEA sentences
+
+#define UBX_NAV_PVT 0x07
+#define UBX_ACK_NAK 0x00
+#define UBX_ACK_ACK 0x01
+#define UBX_CFG_PRT 0x00
+#define UBX_CFG_MSG 0x01
+#define UBX_CFG_CFG 0x09
+#define UBX_CFG_NAV5 0x24
+
+#define UBX_NAV_PVT_LEN 92
+
+typedef struct {
+  uint32_t frames;               // good frames
+  uint32_t bad_checksum;
+  uint32_t oversize;             // len > UBX_MAX_PAYLOAD, skipped
+} ubx_stats_t;
+
+typedef struct {
+  uint8_t  state;
+  uint8_t  cls, id;
+  uint16_t len, idx;
+  uint8_t  ck_a, ck_b;
+  uint8_t  payload[UBX_MAX_PAYLOAD];
+  ubx_stats_t stats;
+} ubx_parser_t;
+
+// NAV-PVT fields we use (units as on the wire)
+typedef struct {
+  uint16_t year;
+  uint8_t  month, day, hour, min, sec;
+  uint8_t  valid;                // bit0 validDate, bit1 validTime, bit2 fullyResolved
+  int32_t  nano;                 // fraction of second, -1e9..1e9 ns
+  uint8_t  fix_type;             // 0 none, 2 2D, 3 3D, ...
+  uint8_t  flags;                // bit0 gnssFixOK
+  uint8_t  num_sv;
+  int32_t  lon_e7, lat_e7;       // deg * 1e7
+  int32_t  hmsl_mm;              // height above MSL
+  int32_t  vel_n_mms, vel_e_mms, vel_d_mms;
+  int32_t  gspeed_mms;
+  uint32_t hacc_mm;
+  uint16_t pdop_x100;
+} ubx_nav_pvt_t;
+
+void ubx_init(ubx_parser_t *p);
+
+// Feed one byte; returns true when a checksummed frame is in p->cls/id/len/payload
+bool ubx_feed(ubx_parser_t *p, uint8_t b);
+
+// Build a complete frame into out[]; returns total bytes or 0 if out is too small
+uint16_t ubx_frame(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len,
+                   uint8_t *out, uint16_t out_size);
+
+// Decode the frame currently in p as NAV-PVT
+bool ubx_decode_nav_pvt(const ubx_parser_t *p, ubx_nav_pvt_t *out);
@@ -0,0 +1,213 @@
+// drivers/si5351/si5351.c
+#include "si5351.h"
+#include "hardware/i2c.h"
+#include "hardware/gpio.h"
+#include "logging.h"
+#include "pico_wspr_horus.h"
+#include <string.h>
+
+#define SI5351_ADDR       0x60
+#define SI5351_I2C_HZ     400000
+
+#define REG_OUT_DISABLE   3
+#define REG_CLK_CTRL(n)   (16 + (n))
+#define REG_PLLA          26
+#define REG_PLLB          34
+#define REG_MS(n)         (42 + 8 * (n))
+#define REG_PLL_RESET     177
+#define REG_XTAL_LOAD     183
+
+#define CLK_PDN           0x80
+#define CLK_MS_INT        0x40
+#define CLK_SRC_PLLB      0x20
+#define CLK_SRC_MS        0x0C
+#define CLK_DRIVE_8MA     0x03
+
+#ifndef SI5351_XTAL_HZ
+#define SI5351_XTAL_HZ    25000000u
+#endif
+#define PLL_MIN_HZ        600000000ull
+#define PLL_MAX_HZ        900000000ull
+#define FRAC_DEN          1048575u    // largest fractional denominator
+#define MS_DIV_MIN        8
+#define MS_DIV_MAX        1800
+
+static bool     s_ok = false;
+static uint32_t s_div[3];               // current integer multisynth divider, 0 = unset
+static uint8_t  s_out_disable = 0xFF;
+static uint8_t  s_pll[2][8];            // shadow of PLLA / PLLB registers
+static bool     s_pll_ok[2];
+
+static bool write_regs(uint8_t reg, const uint8_t *d, size_t n){
+  uint8_t buf[9];
+  if (n > sizeof(buf) - 1) return false;
+  buf[0] = reg;
+  memcpy(&buf[1], d, n);
+  return i2c_write_blocking(I2C_SI_ID, SI5351_ADDR, buf, n + 1, false) == (int)(n + 1);
+}
+
+static bool write_reg(uint8_t reg, uint8_t v){ return write_regs(reg, &v, 1); }
+
+// a + b/c in the chip's P1/P2/P3 encoding; same layout for PLLs and multisynths
+static void pack_params(uint32_t a, uint32_t b, uint32_t c, uint8_t r[8]){
+  uint32_t f  = (128u * b) / c;
+  uint32_t p1 = 128u * a + f - 512u;
+  uint32_t p2 = 128u * b - c * f;
+  uint32_t p3 = c;
+  r[0] = (uint8_t)(p3 >> 8);
+  r[1] = (uint8_t)p3;
+  r[2] = (uint8_t)((p1 >> 16) & 0x03);
+  r[3] = (uint8_t)(p1 >> 8);
+  r[4] = (uint8_t)p1;
+  r[5] = (uint8_t)(((p3 >> 12) & 0xF0) | ((p2 >> 16) & 0x0F));
+  r[6] = (uint8_t)(p2 >> 8);
+  r[7] = (uint8_t)p2;
+}
+
+static uint8_t pll_reg(uint8_t ch){ return ch ? REG_PLLB : REG_PLLA; }
+
+static bool div_fits(uint32_t freq_hz, uint32_t div){
+  uint64_t pll = (uint64_t)freq_hz * div;
+  return div && pll >= PLL_MIN_HZ && pll <= PLL_MAX_HZ;
+}
+
+// Smallest even divider that puts the PLL in range (even integers keep the
+// multisynth jitter lowest)
+static uint32_t plan_div(uint32_t freq_hz){
+  if (!freq_hz) return 0;
+  uint32_t div = (uint32_t)((PLL_MIN_HZ + freq_hz - 1) / freq_hz);
+  if (div & 1u) div++;
+  if (div < MS_DIV_MIN) div = MS_DIV_MIN;
+  if (div > MS_DIV_MAX || !div_fits(freq_hz, div)) return 0;
+  return div;
+}
+
+bool si5351_init(void){
+  i2c_init(I2C_SI_ID, SI5351_I2C_HZ);
+  gpio_set_function(PIN_I2C_SDA, GPIO_FUNC_I2C);
+  gpio_set_function(PIN_I2C_SCL, GPIO_FUNC_I2C);
+  gpio_pull_up(PIN_I2C_SDA);
+  gpio_pull_up(PIN_I2C_SCL);
+
+  s_out_disable = 0xFF;
+  bool ok = write_reg(REG_OUT_DISABLE, s_out_disable);
+  for (uint8_t n = 0; n < 8 && ok; n++) ok = write_reg(REG_CLK_CTRL(n), CLK_PDN);
+  ok = ok && write_reg(REG_XTAL_LOAD, 0xD2);            // 10 pF
+  memset(s_div, 0, sizeof(s_div));
+  memset(s_pll_ok, 0, sizeof(s_pll_ok));
+  s_ok = ok;
+  if (ok) LOGI("si5351: ready (xtal %lu Hz)", (unsigned long)SI5351_XTAL_HZ);
+  else    LOGE("si5351: no answer on I2C");
+  return ok;
+}
+
+// Band change: multisynth divider, full PLL image, then one PLL reset
+static bool program_band(uint8_t ch, uint32_t div, const uint8_t img[8]){
+  uint8_t pll = ch ? 1 : 0;
+  uint8_t ms[8];
+  uint8_t ctrl = CLK_MS_INT | CLK_SRC_MS | CLK_DRIVE_8MA | (ch ? CLK_SRC_PLLB : 0);
+  pack_params(div, 0, 1, ms);
+  s_pll_ok[pll] = false;
+  if (!write_regs(pll_reg(ch), img, 8) ||
+      !write_regs(REG_MS(ch), ms, 8) ||
+      !write_reg(REG_CLK_CTRL(ch), ctrl) ||
+      !write_reg(REG_PLL_RESET, ch ? 0x80 : 0x20)) return false;
+  memcpy(s_pll[pll], img, 8);
+  s_pll_ok[pll] = true;
+  s_div[ch] = div;
+  return true;
+}
+
+bool si5351_tones_init(si5351_tones_t *t, uint8_t channel, uint32_t base_hz,
+                       uint32_t step_uhz, uint8_t n){
+  if (!t || channel > 2 || !n || n > SI5351_MAX_TONES) return false;
+  uint32_t top_hz = base_hz + (uint32_t)(((uint64_t)step_uhz * (n - 1u) + 999999u) / 1000000u);
+
+  // Keep the current divider while the whole table fits under it
+  uint32_t div = s_div[channel];
+  if (!div_fits(base_hz, div) || !div_fits(top_hz, div)) div = plan_div(base_hz);
+  if (!div || !div_fits(top_hz, div)){
+    LOGW("si5351: %lu Hz out of range", (unsigned long)base_hz);
+    return false;
+  }
+
+  // c = m * xtal / (div * step) makes the step exactly m LSBs of b/c; take
+  // the largest m that keeps c in range (finest base resolution). Steps
+  // under one LSB at the largest c fall back to rounding every tone.
+  const uint64_t xtal_uhz = (uint64_t)SI5351_XTAL_HZ * 1000000u;
+  uint64_t step_pll_uhz = (uint64_t)step_uhz * div;
+  uint32_t m = step_pll_uhz ? (uint32_t)((uint64_t)FRAC_DEN * step_pll_uhz / xtal_uhz) : 0;
+  uint32_t c = m ? (uint32_t)((m * xtal_uhz + step_pll_uhz / 2u) / step_pll_uhz) : FRAC_DEN;
+
+  // PLL in LSBs of xtal / c (mHz intermediates keep this inside 64 bits)
+  uint64_t n0 = ((uint64_t)base_hz * div * c + SI5351_XTAL_HZ / 2u) / SI5351_XTAL_HZ;
+  for (uint8_t i = 0; i < n; i++){
+    uint64_t ni = m ? n0 + (uint64_t)i * m
+                    : (((uint64_t)base_hz * 1000u + (uint64_t)i * step_uhz / 1000u) * div * c
+                       + SI5351_XTAL_HZ * 500ull) / (SI5351_XTAL_HZ * 1000ull);
+    pack_params((uint32_t)(ni / c), (uint32_t)(ni % c), c, t->regs[i]);
+  }
+
+  t->channel = channel;
+  t->n_tones = n;
+  t->div = div;
+  t->lo = 7; t->hi = 7;
+  bool any = false;
+  for (uint8_t i = 1; i < n; i++)
+    for (uint8_t j = 0; j < 8; j++)
+      if (t->regs[i][j] != t->regs[0][j]){
+        if (!any || j < t->lo) t->lo = j;
+        if (!any || j > t->hi) t->hi = j;
+        any = true;
+      }
+  return true;
+}
+
+bool si5351_tones_select(const si5351_tones_t *t, uint8_t i){
+  if (!s_ok || !t || i >= t->n_tones) return false;
+  uint8_t ch = t->channel, pll = ch ? 1 : 0;
+  const uint8_t *img = t->regs[i];
+  if (s_div[ch] != t->div) return program_band(ch, t->div, img);
+
+  // Registers auto-increment: one write covering the first..last changed byte
+  int lo = 8, hi = -1;
+  for (int j = 0; j < 8; j++){
+    if (s_pll_ok[pll] && s_pll[pll][j] == img[j]) continue;
+    if (lo > j) lo = j;
+    hi = j;
+  }
+  if (hi < 0) return true;
+  size_t len = (size_t)(hi - lo + 1);
+  if (!write_regs((uint8_t)(pll_reg(ch) + lo), img + lo, len)){
+    s_pll_ok[pll] = false;
+    return false;
+  }
+  memcpy(&s_pll[pll][lo], img + lo, len);
+  s_pll_ok[pll] = true;
+  return true;
+}
+
+uint8_t si5351_tones_burst(const si5351_tones_t *t, uint8_t i, uint16_t out[SI5351_BURST_LEN]){
+  if (!t || i >= t->n_tones) return 0;
+  uint8_t n = 0;
+  out[n++] = (uint16_t)(pll_reg(t->channel) + t->lo);
+  for (uint8_t j = t->lo; j <= t->hi; j++) out[n++] = t->regs[i][j];
+  out[n - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+  return n;
+}
+
+void si5351_shadow_invalidate(uint8_t channel){
+  if (channel <= 2) s_pll_ok[channel ? 1 : 0] = false;
+}
+
+bool si5351_set_freq(uint8_t channel, uint32_t freq_hz){
+  si5351_tones_t t;
+  return si5351_tones_init(&t, channel, freq_hz, 0, 1) && si5351_tones_select(&t, 0);
+}
+
+bool si5351_enable(uint8_t channel, bool en){
+  if (!s_ok || channel > 2) return false;
+  if (en) s_out_disable &= (uint8_t)~(1u << channel);
+  else    s_out_disable |= (uint8_t)(1u << channel);
+  return write_reg(REG_OUT_DISABLE, s_out_disable);
+}
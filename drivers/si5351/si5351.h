@@ -1,7 +1,51 @@
 #pragma once
 #include <stdint.h>
 #include <stdbool.h>
+#include "symbol_player.h"
 
+// CLK0 runs from PLLA (the RF output); CLK1/CLK2 share PLLB. Frequencies are
+// set by moving the PLL fractional feedback under a fixed even integer
+// multisynth divider, so a tone change never resets the PLL or glitches the
+// output. The driver keeps a shadow of each PLL's registers and only writes
+// the bytes that change.
 bool si5351_init(void);
 bool si5351_set_freq(uint8_t channel, uint32_t freq_hz); // CLK0 for RF
 bool si5351_enable(uint8_t channel, bool en);
+
+// Tone table: n tones at base_hz + i * step_uhz / 1e6, in register form.
+// The fractional denominator is picked per table so the step is an exact
+// number of LSBs; the base then resolves to step / m (WSPR on 20 m: ~0.7 Hz)
+// and the spacing is exact to ~1 ppm. Adjacent tones differ in 2-4 register
+// bytes ([lo, hi]), so a symbol change is a 3-5 byte I2C write.
+#define SI5351_MAX_TONES 16
+typedef struct {
+  uint8_t  channel;
+  uint8_t  n_tones;
+  uint8_t  lo, hi;              // PLL register bytes (0..7) that vary across tones
+  uint32_t div;                 // integer multisynth divider for the band
+  uint8_t  regs[SI5351_MAX_TONES][8];
+} si5351_tones_t;
+
+// Pure computation (no I2C): fine to run ahead of the frame
+bool si5351_tones_init(si5351_tones_t *t, uint8_t channel, uint32_t base_hz,
+                       uint32_t step_uhz, uint8_t n);
+// Switch the output to tone i. The first call after a band change programs the
+// multisynth and resets the PLL (task context); after that it writes only the
+// bytes that differ from the chip, which is short enough for the timer IRQ.
+bool si5351_tones_select(const si5351_tones_t *t, uint8_t i);
+
+// Tone i as I2C_DATA_CMD words (start register, bytes lo..hi, STOP on the
+// last) for feeding the I2C TX FIFO directly. Returns the word count
+// (hi - lo + 2, at most SI5351_BURST_LEN). Only valid once the table has been
+// selected, since it assumes the other bytes are already in the chip.
+#define SI5351_BURST_LEN 9
+uint8_t si5351_tones_burst(const si5351_tones_t *t, uint8_t i, uint16_t out[SI5351_BURST_LEN]);
+// Someone else (the DMA sequencer) wrote the PLL: next select writes it whole
+void si5351_shadow_invalidate(uint8_t channel);
+
+// DMA tone sequencer: plays a whole frame with no CPU work between the first
+// and the last edge (see si5351_seq.c). Same contract as the alarm-driven
+// symbol player, which routes here when symbol_play_t.dma is set.
+bool si5351_seq_play(const symbol_play_t *p);
+void si5351_seq_abort(void);
+bool si5351_seq_busy(void);
@@ -0,0 +1,207 @@
+// drivers/si5351/si5351_seq.c -- DMA tone sequencer
+//
+// Three chained channels replay a precomputed frame:
+//
+//   delay  paced by a DMA pacing timer at SEQ_TICK_HZ, copies a dummy word
+//          count[k] times, i.e. it *is* the wait until edge k+1; chains to ctl
+//   ctl    copies count[k+1] into delay's TRANS_COUNT_TRIG (restarting the
+//          wait at the edge itself), then chains to burst
+//   burst  feeds the next tone's DATA_CMD words (only the PLL bytes that vary
+//          across the tone table, 2-5 words) to the I2C TX FIFO; with a
+//          second output it is two transactions back to back, one per PLL
+//
+// ctl and burst keep their read addresses between triggers, so they walk the
+// count[] and burst[] tables by themselves. The CPU takes one alarm at the
+// first edge (to trigger ctl) and one after the last symbol (to stop and
+// notify the owner); nothing in between. Edges land on the pacing tick
+// (10 us) with the same floor(k * num / den) schedule as the alarm player, so
+// there is no drift.
+#include "si5351.h"
+#include "hardware/dma.h"
+#include "hardware/i2c.h"
+#include "hardware/clocks.h"
+#include "pico/time.h"
+#include "logging.h"
+#include "pico_wspr_horus.h"
+#include <stdatomic.h>
+
+#define SEQ_TICK_HZ 100000u
+
+#ifndef SI5351_SEQ_MAX_SYMBOLS
+#define SI5351_SEQ_MAX_SYMBOLS 256      // 22 B each worst case
+#endif
+
+static si5351_tones_t s_tones[2];       // [1] only with a second output
+static uint8_t s_n_out;
+// Stride = both bursts' length. Sized for one worst-case burst per symbol;
+// two real ones (3-5 words each) fit, which each frame checks
+static uint16_t s_burst[SI5351_SEQ_MAX_SYMBOLS * SI5351_BURST_LEN];
+static uint32_t s_count[SI5351_SEQ_MAX_SYMBOLS];
+static uint32_t s_dummy;
+
+static int s_ch_delay = -1, s_ch_ctl = -1, s_ch_burst = -1, s_timer = -1;
+static alarm_id_t s_start_alarm, s_end_alarm;
+static TaskHandle_t s_owner;
+static _Atomic bool s_busy = false;
+
+static bool claim(void){
+  if (s_ch_delay >= 0) return true;
+  s_timer = dma_claim_unused_timer(false);
+  int a = dma_claim_unused_channel(false);
+  int b = dma_claim_unused_channel(false);
+  int c = dma_claim_unused_channel(false);
+  uint32_t y = clock_get_hz(clk_sys) / SEQ_TICK_HZ;
+  if (s_timer < 0 || a < 0 || b < 0 || c < 0 || y > 0xFFFFu){
+    LOGE("si5351: no DMA channels/timer for the sequencer");
+    if (s_timer >= 0) dma_timer_unclaim((uint)s_timer);
+    if (a >= 0) dma_channel_unclaim((uint)a);
+    if (b >= 0) dma_channel_unclaim((uint)b);
+    if (c >= 0) dma_channel_unclaim((uint)c);
+    s_timer = -1;
+    return false;
+  }
+  dma_timer_set_fraction((uint)s_timer, 1, (uint16_t)y);
+  s_ch_delay = a; s_ch_ctl = b; s_ch_burst = c;
+  return true;
+}
+
+// Chains are cut before the abort (RP2040-E13: aborting a channel can still
+// fire its CHAIN_TO)
+static void seq_halt(void){
+  const int chs[2] = { s_ch_delay, s_ch_ctl };
+  for (int i = 0; i < 2; i++){
+    dma_channel_config c = dma_get_channel_config((uint)chs[i]);
+    channel_config_set_chain_to(&c, (uint)chs[i]);
+    dma_channel_set_config((uint)chs[i], &c, false);
+  }
+  dma_channel_abort((uint)s_ch_delay);
+  dma_channel_abort((uint)s_ch_ctl);
+  dma_channel_abort((uint)s_ch_burst);
+}
+
+static void seq_invalidate(void){
+  for (uint8_t i = 0; i < s_n_out; i++) si5351_shadow_invalidate(s_tones[i].channel);
+}
+
+static void seq_done(void){
+  seq_halt();
+  seq_invalidate();
+  TaskHandle_t t = s_owner;
+  atomic_store(&s_busy, false);
+  if (t){
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(t, &woken);
+    portYIELD_FROM_ISR(woken);
+  }
+}
+
+static int64_t seq_start_alarm(alarm_id_t id, void *user){
+  (void)id; (void)user;
+  s_start_alarm = 0;
+  dma_channel_start((uint)s_ch_ctl);
+  return 0;
+}
+
+static int64_t seq_end_alarm(alarm_id_t id, void *user){
+  (void)id; (void)user;
+  s_end_alarm = 0;
+  seq_done();
+  return 0;
+}
+
+static uint64_t edge_tick(const symbol_play_t *p, uint32_t k){
+  return ((uint64_t)k * p->period_num * SEQ_TICK_HZ) / ((uint64_t)p->period_den * 1000000u);
+}
+
+bool si5351_seq_play(const symbol_play_t *p){
+  if (!p || p->n_symbols > SI5351_SEQ_MAX_SYMBOLS || !claim()) return false;
+  bool idle = false;
+  if (!atomic_compare_exchange_strong(&s_busy, &idle, true)) return false;
+
+  // Frame tables. The first tone goes out by plain I2C now, which also sets
+  // the band and every PLL byte the bursts don't touch.
+  s_n_out = p->base2_hz ? 2 : 1;
+  bool ok = p->out <= 2 && (s_n_out == 1 || (p->out2 <= 2 && (p->out ? 1 : 0) != (p->out2 ? 1 : 0)));
+  uint8_t len[2] = {0, 0};
+  for (uint8_t i = 0; i < s_n_out && ok; i++){
+    ok = si5351_tones_init(&s_tones[i], i ? p->out2 : p->out, i ? p->base2_hz : p->base_hz,
+                           p->step_uhz, p->n_tones) &&
+         si5351_tones_select(&s_tones[i], symbol_play_sym(p, 0));
+    len[i] = (uint8_t)(s_tones[i].hi - s_tones[i].lo + 2u);     // same for every tone
+  }
+  uint8_t words = (uint8_t)(len[0] + len[1]);
+  ok = ok && (uint32_t)p->n_symbols * words <= sizeof(s_burst) / sizeof(s_burst[0]);
+  for (uint16_t k = 0; k < p->n_symbols && ok; k++){
+    uint16_t *b = &s_burst[(uint32_t)k * words];
+    ok = si5351_tones_burst(&s_tones[0], symbol_play_sym(p, k), b) == len[0] &&
+         (s_n_out == 1 || si5351_tones_burst(&s_tones[1], symbol_play_sym(p, k), b + len[0]) == len[1]);
+    uint64_t d = edge_tick(p, k + 1u) - edge_tick(p, k);
+    s_count[k] = (k + 1u < p->n_symbols) ? (uint32_t)d : 0xFFFFFFFFu;  // hold the last tone
+  }
+  if (!ok){
+    LOGW("si5351: can't set up the frame's tones");
+    atomic_store(&s_busy, false);
+    return false;
+  }
+
+  dma_channel_config c = dma_channel_get_default_config((uint)s_ch_delay);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+  channel_config_set_read_increment(&c, false);
+  channel_config_set_write_increment(&c, false);
+  channel_config_set_dreq(&c, dma_get_timer_dreq((uint)s_timer));
+  channel_config_set_chain_to(&c, (uint)s_ch_ctl);
+  dma_channel_configure((uint)s_ch_delay, &c, &s_dummy, &s_dummy, 0, false);
+
+  c = dma_channel_get_default_config((uint)s_ch_ctl);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+  channel_config_set_read_increment(&c, true);
+  channel_config_set_write_increment(&c, false);
+  channel_config_set_chain_to(&c, (uint)s_ch_burst);
+  dma_channel_configure((uint)s_ch_ctl, &c, &dma_hw->ch[s_ch_delay].al1_transfer_count_trig,
+                        s_count, 1, false);
+
+  // 16-bit writes to DATA_CMD are replicated into the reserved upper half;
+  // the target address is already in IC_TAR from the selects above, and a
+  // word after a STOP starts the next transaction
+  c = dma_channel_get_default_config((uint)s_ch_burst);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+  channel_config_set_read_increment(&c, true);
+  channel_config_set_write_increment(&c, false);
+  channel_config_set_dreq(&c, i2c_get_dreq(I2C_SI_ID, true));
+  dma_channel_configure((uint)s_ch_burst, &c, &i2c_get_hw(I2C_SI_ID)->data_cmd,
+                        s_burst, words, false);
+
+  // The setup above may have run past the start: the delays are relative,
+  // so moving the whole frame up keeps every edge on its period
+  uint64_t start_us = symbol_player_arm_start(p->start).us;
+  uint64_t end_us = start_us + ((uint64_t)p->n_symbols * p->period_num) / p->period_den;
+  s_owner = p->notify;
+  s_end_alarm = add_alarm_at(from_us_since_boot(end_us), seq_end_alarm, NULL, true);
+  s_start_alarm = s_end_alarm > 0
+    ? add_alarm_at(from_us_since_boot(start_us), seq_start_alarm, NULL, true) : -1;
+  if (s_end_alarm <= 0 || s_start_alarm < 0){
+    if (s_end_alarm > 0) cancel_alarm(s_end_alarm);
+    s_end_alarm = 0;
+    atomic_store(&s_busy, false);
+    return false;
+  }
+  return true;
+}
+
+void si5351_seq_abort(void){
+  if (!atomic_load(&s_busy)) return;
+  // Whoever cancels the end alarm owns the teardown
+  if (!s_end_alarm || !cancel_alarm(s_end_alarm)) return;
+  s_end_alarm = 0;
+  if (s_start_alarm > 0) cancel_alarm(s_start_alarm);
+  s_start_alarm = 0;
+  seq_halt();
+  seq_invalidate();
+  TaskHandle_t t = s_owner;
+  atomic_store(&s_busy, false);
+  if (t) xTaskNotifyGive(t);
+}
+
+bool si5351_seq_busy(void){
+  return atomic_load(&s_busy);
+}
@@ -0,0 +1,36 @@
+#pragma once
+// RTOS object sizing, in one place. Every task, queue, mutex and event group
+// is created statically from these numbers (app_rtos.h), so once main()
+// reaches the scheduler there is nothing left to allocate. The boot log and
+// the console's `ram` command show how much of each stack is ever touched;
+// trim here against those numbers.
+
+// Task stacks, in words (StackType_t is 4 bytes on the RP2040)
+#define APP_STACK_CONSOLE       1024
+#define APP_STACK_RADIO_ARB     1536
+#define APP_STACK_GPS_PWR       1024
+#define APP_STACK_GPS_MON       1024
+#define APP_STACK_WSCHED        1024   // plans slots: grid, telemetry, frame build
+#define APP_STACK_HSCHED        1024
+#define APP_STACK_WSPR_KEYER    1024   // only starts the symbol player and waits
+#define APP_STACK_HORUS_KEYER   1024   // builds each next packet while one is on air
+
+// Priorities
+#define APP_PRIO_CONSOLE        (tskIDLE_PRIORITY + 1)
+#define APP_PRIO_WSCHED         (tskIDLE_PRIORITY + 1)
+#define APP_PRIO_HSCHED         (tskIDLE_PRIORITY + 1)
+#define APP_PRIO_GPS_PWR        (tskIDLE_PRIORITY + 2)
+#define APP_PRIO_GPS_MON        (tskIDLE_PRIORITY + 2)
+#define APP_PRIO_RADIO_ARB      (tskIDLE_PRIORITY + 3)
+#define APP_PRIO_WSPR_KEYER     (tskIDLE_PRIORITY + 3)
+#define APP_PRIO_HORUS_KEYER    (tskIDLE_PRIORITY + 3)
+
+// Queues (the TX job pool itself is TX_JOB_POOL, msg_bus.h)
+#define APP_TX_JOB_QUEUE_LEN    8
+
+// Registry slots for the RAM report: tasks (+ idle and timer) and the
+// queues / mutexes / event groups
+#define APP_RTOS_OBJECTS_MAX    24
+
+// What the report measures against: 256 KB striped SRAM + two 4 KB banks
+#define APP_RAM_BUDGET          (264u * 1024u)
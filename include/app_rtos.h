@@ -0,0 +1,20 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "app_config.h"
+
+/* Static RTOS objects plus a registry for the RAM report. Callers own the
+   buffers (file-scope statics sized from app_config.h), so creation cannot
+   fail; a NULL handle is a configuration bug and asserts. */
+
+TaskHandle_t app_task_create(TaskFunction_t fn, const char *name, void *arg, UBaseType_t prio,
+                             StackType_t *stack, uint32_t stack_words, StaticTask_t *tcb);
+
+// Queues, mutexes, event groups: name and bytes (control block + storage)
+void app_rtos_register(const char *name, size_t bytes);
+
+// Per task: stack size and high-water mark; then every object, the
+// FreeRTOS heap and static RAM against APP_RAM_BUDGET. Boot log and `ram`.
+void app_ram_report(void);
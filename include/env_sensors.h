@@ -0,0 +1,7 @@
+#pragma once
+#include <stdint.h>
+
+/* On-board sensors for the telemetry frames: die temperature (ADC4) and VSYS
+   (ADC3 behind the Pico's 3:1 divider). Safe from any task; the sim reports
+   nominal values. */
+void env_sensors_read(int16_t *temp_c, uint16_t *volt_mv);
@@ -1,6 +1,8 @@
 #pragma once
 #include <stdbool.h>
 #include <stdint.h>
+#include "gps_nmea.h"
+#include "gps_ubx.h"
 
 void gps_power_on_battery_on(void);
 void gps_power_off_battery_on(void);
@@ -10,10 +12,31 @@ void gps_hard_reset(void);
 void gps_uart_enable(void);
 void gps_uart_disable(void);
 
-bool gps_send_ubx(const uint8_t *payload, uint16_t len); // stub-safe
+// RX path counters (UART IRQ -> ring -> monitor task)
+typedef struct {
+  uint32_t rx_bytes;   // bytes pulled from the UART FIFO
+  uint32_t lines;      // NMEA lines handed to the parser
+  uint32_t overruns;   // HW FIFO overruns (bytes lost before the IRQ ran)
+  uint32_t dropped;    // bytes lost because the ring was full
+  uint16_t ring_hwm;   // ring high-water mark (bytes)
+} gps_rx_stats_t;
+
+void gps_rx_get_stats(gps_rx_stats_t *out);
+
+uint32_t gps_pps_edges(void);  // PPS rising edges seen since boot
+
+// NMEA tokenizer counters (good / rejected / bad checksum / overlong)
+void gps_nmea_get_stats(nmea_stats_t *out);
+void gps_ubx_get_stats(ubx_stats_t *out);
+
+// UBX: framed + checksummed. The _ack variant waits for ACK-ACK/NAK (needs the
+// monitor task running; returns false on NAK or timeout).
+bool gps_send_ubx(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len);
+bool gps_send_ubx_ack(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len,
+                      uint32_t timeout_ms);
 
 // “Modes” approximating your C++ API:
-void gps_enable_configuration_mode(void);  // high-alt mode + maximal NMEA (stub)
-void gps_enable_flight_mode(void);         // high-alt mode + minimal NMEA (stub)
+void gps_enable_configuration_mode(void);  // high-alt mode + maximal NMEA
+void gps_enable_flight_mode(void);         // high-alt mode + NAV-PVT only at UART_GPS_BAUD_FAST
 void gps_enter_monitor_mode(void);         // start streaming NMEA to console
 void gps_disable(void);                    // stop monitor + power off(batt on)
\ No newline at end of file
@@ -1,22 +1,55 @@
 #pragma once
 #include <stdint.h>
+#include <stdbool.h>
 #include "FreeRTOS.h"
 #include "queue.h"
 #include "event_groups.h"
+#include "radio_arbiter.h"
+#include "telemetry.h"
 
-typedef struct {
-  int fix_valid; double lat, lon; float alt_m;
-  uint32_t unix_time; uint8_t sats; float hdop;
-} gps_fix_t;
+// TX job: one planned window. req.mode tags the union. Jobs live in a static
+// pool and travel by pointer (producer -> q_tx_jobs -> arbiter calendar),
+// so the struct is written once by the scheduler and never copied again.
+// The arbiter calendar holds up to TX_JOB_POOL jobs: 72 covers an hour of
+// alternating WSPR/Horus slots plus the queue (~56 B each).
+#ifndef TX_JOB_POOL
+#define TX_JOB_POOL 72
+#endif
+
+typedef struct tx_job {
+  radio_req_t req;
+  union {
+    struct { uint32_t slot_epoch; } wspr;    // UTC second of the even-minute slot
+    struct { uint32_t slot_epoch; } horus;   // UTC second of the odd-minute slot
+  } u;
+} tx_job_t;
 
+// Per-channel counters
 typedef struct {
-  gps_fix_t gps;
-  float vbatt_v;
-  int8_t temp_c;
-} telemetry_t;
+  uint32_t publishes;
+  uint32_t drops;      // fix: n/a; tx: pool empty or queue full
+  uint32_t max_lag;    // fix: most publishes a reader skipped; tx: deepest queue seen
+} msg_chan_stats_t;
+
+extern QueueHandle_t q_tx_jobs;        // tx_job_t* (pool-owned)
+extern EventGroupHandle_t eg_system;   // bits: EG_*
 
-extern QueueHandle_t q_gps_fixes;      // gps_fix_t
-extern QueueHandle_t q_tx_jobs;        // union of wspr/horus jobs
-extern EventGroupHandle_t eg_system;   // bits: PPS_LOCK, GPS_LOCK
+#define EG_PPS_LOCK  (1u << 0)   // timebase latched from a PPS edge
+#define EG_GPS_FIX   (1u << 1)   // fresh fix with valid time (set per fix)
 
 void msg_bus_init(void);
+
+// Latest-fix mailbox (seqlock): one writer (GPS task), any task readers. The
+// writer copies inside a critical section, so a reader never waits on it.
+// seq is optional in/out: pass the value from your last read to get lag accounting.
+void msg_bus_publish_fix(const gps_fix_t *fix);
+bool msg_bus_latest_fix(gps_fix_t *out, uint32_t *seq);
+
+// TX job pool + channel. post() hands ownership to the consumer (and frees the
+// job itself on failure); the consumer frees it when the window is done.
+tx_job_t *msg_bus_tx_job_alloc(void);
+void      msg_bus_tx_job_free(tx_job_t *job);
+bool      msg_bus_tx_job_post(tx_job_t *job);
+tx_job_t *msg_bus_tx_job_receive(TickType_t wait);
+
+void msg_bus_get_stats(msg_chan_stats_t *fix, msg_chan_stats_t *tx);
@@ -0,0 +1,37 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "msg_bus.h"
+
+/* Position predictor: dead-reckons lat/lon/alt between GPS fixes so the GPS
+   can stay off. Fixed point throughout (deg*1e7, cm). Rates are measured over
+   long baselines between fixes; the error bound grows with the time since the
+   last fix (rate uncertainty * dt + bounded acceleration * dt^2 / 2). */
+
+typedef struct {
+  int32_t  lat_e7, lon_e7;   // deg * 1e7
+  int32_t  alt_cm;           // MSL
+  uint32_t err_m;            // horizontal error bound at the query time
+  uint32_t age_s;            // seconds since the last fix
+} nav_pos_t;
+
+typedef struct {
+  int32_t  vn_cms, ve_cms, vu_cms;  // current rate estimate, cm/s
+  uint32_t vel_err_cms;             // rate uncertainty
+  uint32_t fixes;                   // fixes ingested
+  uint32_t rate_updates;            // long-baseline rate measurements
+  uint32_t last_fix_utc;
+} nav_predict_stats_t;
+
+void nav_predict_init(void);
+
+/* Feed a fix (GPS task only; single writer). Fixes without fix_valid are ignored. */
+void nav_predict_update(const gps_fix_t *fix);
+
+/* Predicted position at UTC second t. False until the first fix. */
+bool nav_predict_at(uint32_t utc, nav_pos_t *out);
+
+/* Horizontal error bound at UTC second t, UINT32_MAX before the first fix. */
+uint32_t nav_predict_err_m(uint32_t utc);
+
+void nav_predict_get_stats(nav_predict_stats_t *out);
@@ -2,19 +2,82 @@
 #pragma once
 #include <stdint.h>
 #include <stdbool.h>
+#include "timebase.h"
+#include "timing_hist.h"
 
 typedef enum { MODE_WSPR=1, MODE_HORUS=0 } radio_mode_t;
+#define RADIO_MODES 2
+
+// What happened to a request, reported to its owner via status_cb
+typedef enum {
+  RADIO_EV_ACCEPTED,    // on the calendar; t_start is the booked start
+  RADIO_EV_REJECTED,    // lost to an equal/higher-priority window or calendar full
+  RADIO_EV_PREEMPTED,   // displaced by a higher-priority request (booked or on air)
+  RADIO_EV_CANCELLED,   // withdrawn via radio_arbiter_cancel
+  RADIO_EV_MISSED,      // start passed by more than 1 s, not keyed
+} radio_event_t;
 
 typedef struct {
   radio_mode_t mode;
-  uint64_t     t_start_ms;
-  uint32_t     duration_ms;
+  boot_us_t    t_start;
+  uint32_t     duration_us;
   uint32_t     freq_hz;
   void       (*start_cb)(void*);
   void       (*stop_cb)(void*);
   void        *user;
-  uint8_t      priority; // higher wins
+  // Runs on the arbiter task: keep it short and never block. Optional.
+  void       (*status_cb)(void *user, radio_event_t ev, boot_us_t t_start);
+  uint32_t     slack_us; // may start up to this much later to fit a gap
+  uint32_t     lead_us;  // start_cb runs this early, so the owner can arm for t_start
+  uint8_t      priority; // higher wins; ties go to the window already booked
 } radio_req_t;
 
+// Between windows of different modes: retune + PA settle
+#define RADIO_MODE_GUARD_US 2000000u
+
+// The arbiter sleeps until its next deadline (window start or end); submit and
+// cancel wake it, and both are taken in while a window is on the air.
+
+// Copies *req into a pooled tx_job_t and posts it to the arbiter
 bool radio_arbiter_submit(const radio_req_t *req);
+// Zero-copy path: post a job from msg_bus_tx_job_alloc(); the arbiter owns it after this
+struct tx_job;
+bool radio_arbiter_submit_job(struct tx_job *job);
+// Withdraw booked windows of `mode` for UTC slot `slot_epoch` (0 = all of
+// that mode); a matching window on the air is stopped. Applied asynchronously,
+// but the arbiter outranks every scheduler, so before the caller runs again.
+bool radio_arbiter_cancel(radio_mode_t mode, uint32_t slot_epoch);
+// Earliest calendar start >= after; false if nothing is booked
+bool radio_arbiter_next_start(boot_us_t after, boot_us_t *t_start);
+// Booked start of the window on the air, for its start_cb / stop_cb (they run
+// on the arbiter task); false outside a window
+bool radio_arbiter_active_start(boot_us_t *t_start);
+
+typedef struct {
+  uint32_t admitted;      // booked on the calendar
+  uint32_t rejected;      // lost an overlap or found the calendar full
+  uint32_t preempted;     // displaced by a higher-priority overlap
+  uint32_t cancelled;     // withdrawn via radio_arbiter_cancel
+  uint32_t missed;        // start passed by more than 1 s (not run)
+  uint32_t windows;       // windows run
+} radio_mode_stats_t;
+
+// Why a booked window was never keyed (each one is also logged as MISSED)
+typedef enum {
+  RADIO_MISS_LATE,        // arbiter reached it more than 1 s after t_start
+  RADIO_MISS_HW_LOCK,     // radio mutex not free within 500 ms
+  RADIO_MISS_CAUSES
+} radio_miss_t;
+
+typedef struct {
+  radio_mode_stats_t mode[RADIO_MODES];   // indexed by radio_mode_t
+  timing_hist_t late;     // start_cb after t_start - lead_us, every window reached (missed too)
+  timing_hist_t cb;       // start_cb / stop_cb run time
+  uint32_t miss[RADIO_MISS_CAUSES];
+  uint32_t aborted;       // windows cut short on the air (preempt / cancel)
+  uint16_t booked, booked_max;            // calendar depth now / high-water
+} radio_arbiter_stats_t;
+
+void radio_arbiter_get_stats(radio_arbiter_stats_t *out);
+void radio_arbiter_reset_stats(void);
 void task_radio_arbiter_start(void);
\ No newline at end of file
@@ -2,12 +2,29 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+// Outputs 0..RADIO_HW_OUTPUTS-1 (SI5351 CLK0..2). CLK0 has PLLA to itself;
+// CLK1 and CLK2 share PLLB, so at most two outputs can carry independent tones.
+#define RADIO_HW_OUTPUTS 3
+
+// Outputs that radio_hw_enable() switches and radio_hw_set_tone() keys
+// (bit n = output n). Default: output 0 only. Drops the other outputs' plans.
+void radio_hw_select_outputs(uint8_t mask);
+
 // Turn the RF path on/off (PA/buffer etc.). For SI5351 this might just enable/disable CLKx.
 void radio_hw_enable(bool on);
 
 // Set RF output frequency in Hz. For SI5351 you’ll set CLKx to this freq.
 void radio_hw_set_freq_hz(uint32_t hz);
 
+// FSK tone plan for one selected output: n tones at base_hz + i * step_uhz /
+// 1e6 (sub-Hz spacing is kept). Task context, before a frame; the backend may
+// precompute registers. False if another planned output shares its PLL.
+bool radio_hw_set_tones(uint8_t out, uint32_t base_hz, uint32_t step_uhz, uint8_t n);
+
+// Switch every planned output to its tone i. Called from the symbol player's
+// timer IRQ: must not block for long or print.
+void radio_hw_set_tone(uint8_t i);
+
 // Optional: called once on boot by the arbiter
 void radio_hw_init(void);
 
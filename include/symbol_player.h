@@ -0,0 +1,82 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timebase.h"
+#include "timing_hist.h"
+
+/* Alarm-driven FSK symbol player, shared by every mode (WSPR, Horus 4FSK).
+   Symbol k starts exactly at start + floor(k * period_num / period_den) us, so
+   a rational period (WSPR: 2048000/3 us) never accumulates drift. Tone changes
+   happen in the timer IRQ via radio_hw_set_tone(), which therefore must be
+   ISR-safe; the tone plan is handed to radio_hw_set_tones() at start.
+
+   Frames can be chained: symbol_player_queue() parks one more frame with the
+   same tone plan, outputs and period, and the IRQ starts it on the current
+   frame's end edge, so the whole chain stays on one schedule. The owner is
+   notified (xTaskNotifyGive) at the end of every frame; a frame's symbols[]
+   must stay valid until its own notification.
+
+   With .dma set and the SI5351 backend built in (RADIO_HW_SI5351), the frame
+   is handed to the DMA tone sequencer instead: all PLL register bursts are
+   computed up front and a timer-paced DMA chain writes them to I2C, so there
+   is no IRQ per symbol. That path plays one frame at a time and can't be
+   queued on. Edge errors are not sampled in that mode and read 0 (edges sit
+   on a 10 us pacing tick by construction). Without the backend .dma is
+   ignored. */
+
+typedef struct {
+  const uint8_t  *symbols;      // tone indices, 2 bits each, LSB-first (<= 4 tones)
+  uint16_t        n_symbols;
+  uint32_t        base_hz;      // tone i = base_hz + i * step_uhz / 1e6
+  uint32_t        step_uhz;
+  uint8_t         out;          // radio output for base_hz
+  uint32_t        base2_hz;     // optional second output keyed with the same
+  uint8_t         out2;         //   symbols (0 Hz = none); must be on the other PLL
+  uint8_t         n_tones;
+  uint32_t        period_num;   // symbol period = num / den microseconds
+  uint32_t        period_den;
+  boot_us_t       start;        // edge of symbol 0 (moved up to now if already past)
+  TaskHandle_t    notify;       // woken when the frame ends; may be NULL
+  bool            dma;          // prefer the SI5351 DMA sequencer
+} symbol_play_t;
+
+typedef struct {
+  uint32_t frames;              // completed (or aborted) frames
+  uint32_t aborted;
+  uint32_t symbols;             // edges played since boot
+  uint32_t late_edges;          // edges more than SYMBOL_LATE_US after ideal
+  uint32_t err_max_us;          // worst edge error since boot
+  uint32_t last_err_max_us;     // worst / mean edge error of the last frame
+  uint32_t last_err_avg_us;
+  uint32_t late_starts;         // frames whose start had passed when armed
+  uint32_t last_start_late_us;  // how far the last frame's symbol 0 moved
+  timing_hist_t edge_err;       // every alarm-driven edge since the last reset
+} symbol_player_stats_t;
+
+#define SYMBOL_LATE_US 50
+// A start that has gone by when the frame is armed moves to now + this: the
+// frame goes out whole and late, instead of its missed edges back to back
+#define SYMBOL_ARM_MARGIN_US 100
+
+// Tone of symbol k (same packing wspr_build_packed() emits)
+static inline uint8_t symbol_play_sym(const symbol_play_t *p, uint16_t k){
+  return (uint8_t)((p->symbols[k >> 2] >> ((k & 3u) * 2u)) & 3u);
+}
+
+bool symbol_player_start(const symbol_play_t *p);   // false if busy or invalid
+// Back-to-back frames, alarm path only: next's symbol 0 goes out on the
+// playing frame's end edge, from the same IRQ, on the same schedule (its
+// .start is ignored). Tone plan and period must match the playing frame's.
+// The owner is still notified at each frame end; queue the one after that
+// from there. False if nothing is playing, on DMA, already queued, or the
+// frame ended meanwhile.
+bool symbol_player_queue(const symbol_play_t *next);
+// For the DMA sequencer: symbol 0's edge for a frame booked at `start` and
+// armed now (see SYMBOL_ARM_MARGIN_US); counts it in late_starts if it moved
+boot_us_t symbol_player_arm_start(boot_us_t start);
+void symbol_player_abort(void);                     // ends at the next symbol edge
+bool symbol_player_busy(void);
+void symbol_player_get_stats(symbol_player_stats_t *out);
+void symbol_player_reset_stats(void);
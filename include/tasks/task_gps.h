@@ -1,3 +1,17 @@
 #pragma once
+#include <stdint.h>
+#include <stdbool.h>
 
-void task_gps_start(void);
\ No newline at end of file
+typedef struct {
+  bool     on;                // receiver powered right now
+  uint32_t lead_s;            // wake-up lead before a TX window
+  uint32_t last_ttf_ms;       // last measured hot-start time-to-fix
+  uint32_t on_s_this_hour;
+  uint32_t on_s_last_hour;
+  uint32_t cycles;            // power-ups since boot
+  uint32_t misses;            // windows we couldn't get a fix for
+  uint32_t skips;             // windows served from the position predictor
+} gps_pwr_stats_t;
+
+void task_gps_start(void);
+void gps_pwr_get_stats(gps_pwr_stats_t *out);
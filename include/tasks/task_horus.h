@@ -0,0 +1,37 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// One Horus window: hsched books it in an odd minute, after the previous
+// minute's WSPR window if there is one; the keyer fills it with back-to-back
+// packets (17 at 100 baud, 51 at 300)
+#define HORUS_WINDOW_US 50000000u
+// The keyer is called this far ahead of the window: packet 0's build
+// (predictor, sensors, FEC) and the tone setup run before its first edge
+#define HORUS_KEY_LEAD_US 20000u
+
+typedef struct {
+  uint16_t payload_id;   // horusdemodlib payload ID (256 = 4FSKTEST-V2)
+  uint16_t baud;         // 100 or 300
+  uint32_t base_hz;      // tone 0
+  uint32_t step_hz;      // tone spacing
+} horus_cfg_t;
+
+typedef struct {
+  uint32_t windows;      // windows keyed
+  uint32_t packets;      // packets sent in full
+  uint32_t underruns;    // next packet not queued in time (the chain ended early)
+  uint32_t last_packets; // in the last window
+  uint32_t last_err_max_us;   // worst symbol edge error of the last window
+  uint16_t seq;          // next packet counter
+} horus_stats_t;
+
+void horus_cfg_get(horus_cfg_t *out);
+bool horus_cfg_set(const horus_cfg_t *cfg);     // false if out of range
+void horus_get_stats(horus_stats_t *out);
+
+// Arbiter callbacks; user = the odd minute's UTC epoch
+void horus_start(void *user);
+void horus_stop(void *user);
+
+void task_horus_start(void);
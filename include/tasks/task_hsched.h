@@ -0,0 +1,2 @@
+#pragma once
+void task_hsched_start(void);
@@ -0,0 +1,17 @@
+#pragma once
+#include <stdint.h>
+
+// Plain data shared by the bus, the predictor and the encoders; no RTOS
+// types, so the encoders build on a host as they are
+
+typedef struct {
+  int fix_valid; int32_t lat_e7, lon_e7; int32_t alt_cm;  // deg*1e7, cm MSL
+  uint32_t unix_time; uint8_t sats; uint16_t hdop_x100;
+} gps_fix_t;
+
+typedef struct {
+  gps_fix_t gps;
+  float vbatt_v;
+  int8_t temp_c;
+  uint16_t speed_kph;  // ground speed
+} telemetry_t;
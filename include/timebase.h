@@ -1,19 +1,60 @@
 #pragma once
 #include <stdint.h>
 #include <stdbool.h>
+#include "FreeRTOS.h"
 
-void     timebase_init(void);
+/* Two time domains, both in microseconds, kept as distinct types so one
+   can't be passed where the other is expected:
+     boot_us_t - monotonic since boot (time_us_64), always valid
+     utc_us_t  - since the Unix epoch, valid once GPS has latched */
+typedef struct { uint64_t us; } boot_us_t;
+typedef struct { uint64_t us; } utc_us_t;
 
-/* Set UTC from GPS (RMC). Year is two-digit (e.g., 25 for 2025). */
-void     timebase_set_utc_from_rmc(int hh, int mm, int ss,
+static inline utc_us_t  utc_from_epoch(uint32_t s){ return (utc_us_t){ (uint64_t)s * 1000000ULL }; }
+static inline uint32_t  utc_epoch(utc_us_t u){ return (uint32_t)(u.us / 1000000ULL); }
+static inline boot_us_t boot_add_us(boot_us_t b, int64_t d){ return (boot_us_t){ b.us + (uint64_t)d }; }
+static inline int64_t   boot_diff_us(boot_us_t a, boot_us_t b){ return (int64_t)(a.us - b.us); }
+static inline bool      boot_before(boot_us_t a, boot_us_t b){ return a.us < b.us; }
+
+boot_us_t timebase_boot_now(void);
+bool      timebase_now(boot_us_t *boot, utc_us_t *utc);    // both from one reading; false if no UTC
+bool      timebase_utc_at(boot_us_t b, utc_us_t *out);      // UTC at a boot instant
+bool      timebase_boot_at(utc_us_t u, boot_us_t *out);     // boot instant of a UTC time
+
+/* Deadline -> FreeRTOS ticks, rounded up so a task never wakes early; 0 if
+   already past. One exact delay instead of polling lets tickless idle sleep. */
+TickType_t timebase_ticks_until(boot_us_t deadline);
+void       timebase_delay_until(boot_us_t deadline);
+
+/* Set UTC from GPS (RMC). Year is two-digit (e.g., 25 for 2025).
+   If a PPS edge was seen within the last second and ms==0, the UTC second is
+   bound to that edge's timestamp instead of to the parse time. */
+void     timebase_set_utc_from_rmc(int hh, int mm, int ss, int ms,
                                    int day, int mon, int yy); // <-- shim (yy=00..99)
 
+/* PPS rising edge, boot-time microseconds. Safe to call from an ISR. */
+void     timebase_pps_from_isr(uint64_t boot_us);
+bool     timebase_pps_locked(void);  // current latch came from a PPS edge
+
 /* Query time */
-uint64_t timebase_now_ms(void);      // ms since Unix epoch
-uint32_t timebase_now_unix(void);    // whole seconds since Unix epoch
 bool     timebase_is_valid(void);    // true after first set
 bool     timebase_utc_valid(void); 
 uint32_t timebase_utc_now(void);              // seconds since epoch (UTC)
 void     timebase_set_utc_now(uint32_t epoch);// call when GPS gives you valid UTC
-uint64_t timebase_epoch_to_boot_ms(uint32_t epoch_sec); // <-- add this
-uint64_t timebase_now_boot_ms(void);          // convenience
\ No newline at end of file
+uint64_t timebase_now_boot_ms(void);          // boot domain, ms (accounting/logs)
+
+/* Holdover: the crystal's frequency error is measured between latches and
+   applied continuously; small corrections are slewed, not stepped. */
+typedef struct {
+  bool     valid;
+  bool     pps;            // last latch from a PPS edge
+  int32_t  ppb;            // estimated crystal error (+ = fast)
+  uint32_t ppb_unc;
+  uint32_t err_us;         // estimated UTC error right now
+  uint32_t age_s;          // since the last latch
+  int32_t  slewing_us;     // correction still being walked in
+  uint32_t steps, slews, freq_updates;
+} timebase_status_t;
+
+void     timebase_get_status(timebase_status_t *out);
+uint32_t timebase_error_us_at(uint32_t epoch_sec); // expected UTC error at that second
\ No newline at end of file
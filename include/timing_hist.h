@@ -0,0 +1,24 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/* Fixed-bucket latency histogram for timing telemetry (arbiter start
+   lateness, callback run time, symbol edge error). Buckets follow a 1-2-5
+   series in microseconds: bin i counts samples below timing_hist_edge_us[i],
+   the last bin everything from 1 s up. Adding is a few compares and an
+   increment, safe from a timer IRQ as long as each histogram has one writer. */
+
+#define TIMING_HIST_BINS 15
+
+typedef struct {
+  uint32_t bin[TIMING_HIST_BINS];
+  uint32_t n;
+  uint32_t max_us;
+} timing_hist_t;
+
+extern const uint32_t timing_hist_edge_us[TIMING_HIST_BINS - 1];
+
+void timing_hist_add(timing_hist_t *h, uint32_t us);
+
+/* "n=12 max=830us <10:3 <20:5 <1ms:4" -- empty bins skipped; returns len */
+size_t timing_hist_format(const timing_hist_t *h, char *buf, size_t len);
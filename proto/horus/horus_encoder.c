@@ -0,0 +1,344 @@
+#include "horus_encoder.h"
+#include <stdio.h>
+#include <string.h>
+
+// ========================= Spec constants =========================
+static const uint8_t UW[HORUS_UW_BYTES] = { 0x24, 0x24 };   // "$$"
+#define PREAMBLE_BYTE 0x1B
+
+// Bits behind the UW that get interleaved and scrambled
+#define CODED_BYTES (HORUS_V2_FRAME_BYTES - HORUS_UW_BYTES)   // 63
+#define CODED_BITS  (CODED_BYTES * 8)                          // 504
+// Interleaver step: horus_l2.c takes the largest entry of its prime table
+// below the bit count. The table jumps from 389 to 757, so 504 bits get 389
+// (not 503); any other value breaks compatibility.
+#define IL_B 389u
+
+// Golay(23,12) generator and the 12-bit groups the payload splits into
+#define GOLAY_GENPOL 0xC75u
+#define GOLAY_WORDS  ((HORUS_V2_PAYLOAD_BYTES * 8) / 12)       // 21 full, then a 4-bit tail
+
+// CRC16-CCITT, one entry per byte. Generated offline; checked by horus_selftest().
+static const uint16_t CRC16[256] = {
+  0x0000,0x1021,0x2042,0x3063,0x4084,0x50A5,0x60C6,0x70E7,
+  0x8108,0x9129,0xA14A,0xB16B,0xC18C,0xD1AD,0xE1CE,0xF1EF,
+  0x1231,0x0210,0x3273,0x2252,0x52B5,0x4294,0x72F7,0x62D6,
+  0x9339,0x8318,0xB37B,0xA35A,0xD3BD,0xC39C,0xF3FF,0xE3DE,
+  0x2462,0x3443,0x0420,0x1401,0x64E6,0x74C7,0x44A4,0x5485,
+  0xA56A,0xB54B,0x8528,0x9509,0xE5EE,0xF5CF,0xC5AC,0xD58D,
+  0x3653,0x2672,0x1611,0x0630,0x76D7,0x66F6,0x5695,0x46B4,
+  0xB75B,0xA77A,0x9719,0x8738,0xF7DF,0xE7FE,0xD79D,0xC7BC,
+  0x48C4,0x58E5,0x6886,0x78A7,0x0840,0x1861,0x2802,0x3823,
+  0xC9CC,0xD9ED,0xE98E,0xF9AF,0x8948,0x9969,0xA90A,0xB92B,
+  0x5AF5,0x4AD4,0x7AB7,0x6A96,0x1A71,0x0A50,0x3A33,0x2A12,
+  0xDBFD,0xCBDC,0xFBBF,0xEB9E,0x9B79,0x8B58,0xBB3B,0xAB1A,
+  0x6CA6,0x7C87,0x4CE4,0x5CC5,0x2C22,0x3C03,0x0C60,0x1C41,
+  0xEDAE,0xFD8F,0xCDEC,0xDDCD,0xAD2A,0xBD0B,0x8D68,0x9D49,
+  0x7E97,0x6EB6,0x5ED5,0x4EF4,0x3E13,0x2E32,0x1E51,0x0E70,
+  0xFF9F,0xEFBE,0xDFDD,0xCFFC,0xBF1B,0xAF3A,0x9F59,0x8F78,
+  0x9188,0x81A9,0xB1CA,0xA1EB,0xD10C,0xC12D,0xF14E,0xE16F,
+  0x1080,0x00A1,0x30C2,0x20E3,0x5004,0x4025,0x7046,0x6067,
+  0x83B9,0x9398,0xA3FB,0xB3DA,0xC33D,0xD31C,0xE37F,0xF35E,
+  0x02B1,0x1290,0x22F3,0x32D2,0x4235,0x5214,0x6277,0x7256,
+  0xB5EA,0xA5CB,0x95A8,0x8589,0xF56E,0xE54F,0xD52C,0xC50D,
+  0x34E2,0x24C3,0x14A0,0x0481,0x7466,0x6447,0x5424,0x4405,
+  0xA7DB,0xB7FA,0x8799,0x97B8,0xE75F,0xF77E,0xC71D,0xD73C,
+  0x26D3,0x36F2,0x0691,0x16B0,0x6657,0x7676,0x4615,0x5634,
+  0xD94C,0xC96D,0xF90E,0xE92F,0x99C8,0x89E9,0xB98A,0xA9AB,
+  0x5844,0x4865,0x7806,0x6827,0x18C0,0x08E1,0x3882,0x28A3,
+  0xCB7D,0xDB5C,0xEB3F,0xFB1E,0x8BF9,0x9BD8,0xABBB,0xBB9A,
+  0x4A75,0x5A54,0x6A37,0x7A16,0x0AF1,0x1AD0,0x2AB3,0x3A92,
+  0xFD2E,0xED0F,0xDD6C,0xCD4D,0xBDAA,0xAD8B,0x9DE8,0x8DC9,
+  0x7C26,0x6C07,0x5C64,0x4C45,0x3CA2,0x2C83,0x1CE0,0x0CC1,
+  0xEF1F,0xFF3E,0xCF5D,0xDF7C,0xAF9B,0xBFBA,0x8FD9,0x9FF8,
+  0x6E17,0x7E36,0x4E55,0x5E74,0x2E93,0x3EB2,0x0ED1,0x1EF0
+};
+
+// Golay parity is linear in the data word, so 11 parity bits of a 12-bit word
+// d are GOLAY_HI[d >> 6] ^ GOLAY_LO[d & 63]: 256 B of tables instead of 8 KB.
+// Generated offline; checked by horus_selftest().
+static const uint16_t GOLAY_HI[64] = {
+  0x000,0x6CC,0x1ED,0x721,0x3DA,0x516,0x237,0x4FB,
+  0x7B4,0x178,0x659,0x095,0x46E,0x2A2,0x583,0x34F,
+  0x31D,0x5D1,0x2F0,0x43C,0x0C7,0x60B,0x12A,0x7E6,
+  0x4A9,0x265,0x544,0x388,0x773,0x1BF,0x69E,0x052,
+  0x63A,0x0F6,0x7D7,0x11B,0x5E0,0x32C,0x40D,0x2C1,
+  0x18E,0x742,0x063,0x6AF,0x254,0x498,0x3B9,0x575,
+  0x527,0x3EB,0x4CA,0x206,0x6FD,0x031,0x710,0x1DC,
+  0x293,0x45F,0x37E,0x5B2,0x149,0x785,0x0A4,0x668
+};
+static const uint16_t GOLAY_LO[64] = {
+  0x000,0x475,0x49F,0x0EA,0x54B,0x13E,0x1D4,0x5A1,
+  0x6E3,0x296,0x27C,0x609,0x3A8,0x7DD,0x737,0x342,
+  0x1B3,0x5C6,0x52C,0x159,0x4F8,0x08D,0x067,0x412,
+  0x750,0x325,0x3CF,0x7BA,0x21B,0x66E,0x684,0x2F1,
+  0x366,0x713,0x7F9,0x38C,0x62D,0x258,0x2B2,0x6C7,
+  0x585,0x1F0,0x11A,0x56F,0x0CE,0x4BB,0x451,0x024,
+  0x2D5,0x6A0,0x64A,0x23F,0x79E,0x3EB,0x301,0x774,
+  0x436,0x043,0x0A9,0x4DC,0x17D,0x508,0x5E2,0x197
+};
+
+// The additive scrambler restarts from 0x4a80 every frame, so its output over
+// the coded bits is a constant: XOR with this (bit i = byte i/8, bit i%8).
+// Generated offline; checked by horus_selftest().
+static const uint8_t SCRAMBLE[CODED_BYTES] = {
+  0xC0,0x6F,0x10,0x2C,0x0C,0x1D,0xC5,0xC9,0x93,0x16,0xED,0xCE,
+  0xCD,0x94,0x55,0xAF,0x7F,0x3C,0x20,0x11,0xD8,0x0C,0x5A,0x85,
+  0xFB,0x23,0x03,0x59,0xC1,0xFA,0xD0,0x43,0x1C,0x31,0xC9,0xD4,
+  0x56,0xDF,0x7E,0xD8,0x20,0x5A,0x98,0x3B,0x2A,0x93,0x5F,0x2D,
+  0xF8,0x1D,0x82,0x89,0xA1,0xA6,0xF8,0x7A,0xC2,0xA3,0x11,0xB9,
+  0xCC,0x72,0xD5
+};
+
+// ========================= Helpers =========================
+static inline void put16le(uint8_t *p, uint16_t v){ p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+
+static inline uint8_t clamp_u8(int32_t v){ return (uint8_t)(v < 0 ? 0 : v > 255 ? 255 : v); }
+
+static inline uint16_t golay_parity(uint16_t d){
+  return (uint16_t)(GOLAY_HI[(d >> 6) & 63u] ^ GOLAY_LO[d & 63u]);
+}
+
+// Symbol player packing: the byte's top pair is the first symbol, so swap the
+// order of the four pairs
+static inline uint8_t swap_pairs(uint8_t b){
+  b = (uint8_t)((b >> 4) | (b << 4));
+  return (uint8_t)(((b & 0xCCu) >> 2) | ((b & 0x33u) << 2));
+}
+
+// ========================= Payload =========================
+void horus_pack_v2(const telemetry_t *t, const horus_v2_hdr_t *h,
+                   uint8_t out[HORUS_V2_PAYLOAD_BYTES]){
+  const gps_fix_t *g = &t->gps;
+  memset(out, 0, HORUS_V2_PAYLOAD_BYTES);
+  put16le(&out[0], h->payload_id);
+  put16le(&out[2], h->seq);
+  uint32_t tod = g->unix_time % 86400u;
+  out[4] = (uint8_t)(tod / 3600u);
+  out[5] = (uint8_t)(tod / 60u % 60u);
+  out[6] = (uint8_t)(tod % 60u);
+  if (g->fix_valid){
+    // IEEE-754 single, little-endian like the rest (RP2040 and hosts alike)
+    float lat = (float)g->lat_e7 * 1e-7f, lon = (float)g->lon_e7 * 1e-7f;
+    memcpy(&out[7], &lat, 4);
+    memcpy(&out[11], &lon, 4);
+    int32_t alt = g->alt_cm / 100;
+    put16le(&out[15], (uint16_t)(alt < 0 ? 0 : alt > 65535 ? 65535 : alt));
+    out[18] = g->sats;
+  }
+  out[17] = clamp_u8(t->speed_kph);
+  out[19] = (uint8_t)t->temp_c;
+  out[20] = clamp_u8((int32_t)(t->vbatt_v * (255.0f / 5.0f) + 0.5f));
+  memcpy(&out[21], h->custom, sizeof(h->custom));
+  put16le(&out[30], horus_crc16(out, HORUS_V2_PAYLOAD_BYTES - 2));
+}
+
+uint16_t horus_crc16(const uint8_t *d, size_t n){
+  uint16_t c = 0xFFFFu;
+  while (n--) c = (uint16_t)((c << 8) ^ CRC16[(uint8_t)((c >> 8) ^ *d++)]);
+  return c;
+}
+
+// ========================= Frame =========================
+void horus_encode_frame(const uint8_t payload[HORUS_V2_PAYLOAD_BYTES],
+                        uint8_t frame[HORUS_V2_FRAME_BYTES]){
+  uint8_t coded[CODED_BYTES];
+  memcpy(coded, payload, HORUS_V2_PAYLOAD_BYTES);
+
+  // Parity, 11 bits per 12-bit group, MSB-first. acc keeps the unflushed bits
+  // at the bottom; whatever shifts off the top has already been written.
+  uint8_t *par = &coded[HORUS_V2_PAYLOAD_BYTES];
+  uint32_t acc = 0;
+  int nacc = 0;
+  for (int w = 0; w <= GOLAY_WORDS; w++){
+    uint16_t d;
+    if (w == GOLAY_WORDS){
+      // The 4 bits left over go in as horus_l2.c leaves them: shifted up one
+      d = (uint16_t)((payload[HORUS_V2_PAYLOAD_BYTES - 1] & 0x0Fu) << 1);
+    } else {
+      const uint8_t *b = &payload[w * 3 / 2];
+      d = (w & 1) ? (uint16_t)(((b[0] & 0x0Fu) << 8) | b[1])
+                  : (uint16_t)((b[0] << 4) | (b[1] >> 4));
+    }
+    acc = (acc << 11) | golay_parity(d);
+    for (nacc += 11; nacc >= 8; nacc -= 8) *par++ = (uint8_t)(acc >> (nacc - 8));
+  }
+  if (nacc) *par = (uint8_t)(acc << (8 - nacc));
+
+  // Interleave (bit i -> bit i * IL_B mod CODED_BITS, LSB-first bit numbering),
+  // then scramble
+  memcpy(frame, UW, HORUS_UW_BYTES);
+  uint8_t *o = &frame[HORUS_UW_BYTES];
+  memset(o, 0, CODED_BYTES);
+  for (uint16_t i = 0, j = 0; i < CODED_BITS; i++){
+    if ((coded[i >> 3] >> (i & 7)) & 1u) o[j >> 3] |= (uint8_t)(1u << (j & 7));
+    j = (uint16_t)(j + IL_B);
+    if (j >= CODED_BITS) j = (uint16_t)(j - CODED_BITS);
+  }
+  for (int k = 0; k < CODED_BYTES; k++) o[k] ^= SCRAMBLE[k];
+}
+
+void horus_build_v2(const telemetry_t *t, const horus_v2_hdr_t *h,
+                    uint8_t out[HORUS_V2_PACKED_BYTES]){
+  uint8_t payload[HORUS_V2_PAYLOAD_BYTES];
+  horus_pack_v2(t, h, payload);
+  uint8_t *fr = &out[HORUS_PREAMBLE_BYTES];
+  horus_encode_frame(payload, fr);
+  for (int k = 0; k < HORUS_PREAMBLE_BYTES; k++) out[k] = swap_pairs(PREAMBLE_BYTE);
+  for (int k = 0; k < HORUS_V2_FRAME_BYTES; k++) fr[k] = swap_pairs(fr[k]);
+}
+
+// ========================= Self-test =========================
+// Bit-serial port of horus_l2.c (golay23 get_syndrome, the bit-at-a-time
+// encoder, interleave() and scramble()), the reference for the table path
+static uint32_t ref_syndrome(uint32_t pattern){
+  uint32_t aux = 1u << 22;
+  if (pattern >= (1u << 11)){
+    while (pattern & 0xFFFFF800u){
+      while (!(aux & pattern)) aux >>= 1;
+      pattern ^= (aux >> 11) * GOLAY_GENPOL;
+    }
+  }
+  return pattern;
+}
+
+static uint16_t ref_crc16(const uint8_t *d, size_t n){
+  uint16_t c = 0xFFFFu;
+  while (n--){
+    c ^= (uint16_t)(*d++ << 8);
+    for (int b = 0; b < 8; b++) c = (c & 0x8000u) ? (uint16_t)((c << 1) ^ 0x1021u) : (uint16_t)(c << 1);
+  }
+  return c;
+}
+
+static void ref_encode(const uint8_t *payload, uint8_t *out){
+  memcpy(out, UW, HORUS_UW_BYTES);
+  memcpy(&out[HORUS_UW_BYTES], payload, HORUS_V2_PAYLOAD_BYTES);
+  uint8_t *pout = &out[HORUS_UW_BYTES + HORUS_V2_PAYLOAD_BYTES];
+  uint32_t ingolay = 0, paritybyte = 0;
+  int ningolay = 0, nparitybits = 0;
+  for (int i = 0; i < HORUS_V2_PAYLOAD_BYTES; i++){
+    for (int j = 7; j >= 0; j--){
+      ingolay |= (payload[i] >> j) & 1u;
+      ningolay++;
+      if (ningolay % 12){
+        ingolay <<= 1;
+        continue;
+      }
+      uint32_t golayparity = ref_syndrome(ingolay << 11);
+      ingolay = 0;
+      for (int k = 10; k >= 0; k--){
+        paritybyte |= (golayparity >> k) & 1u;
+        nparitybits++;
+        if (nparitybits % 8) paritybyte <<= 1;
+        else { *pout++ = (uint8_t)paritybyte; paritybyte = 0; }
+      }
+    }
+  }
+  if (ningolay % 12){
+    ingolay >>= 1;
+    uint32_t golayparity = ref_syndrome(ingolay << 12);
+    for (int k = 10; k >= 0; k--){
+      paritybyte |= (golayparity >> k) & 1u;
+      nparitybits++;
+      if (nparitybits % 8) paritybyte <<= 1;
+      else { *pout++ = (uint8_t)paritybyte; paritybyte = 0; }
+    }
+  }
+  if (nparitybits % 8){
+    paritybyte <<= 7 - (nparitybits % 8);
+    *pout = (uint8_t)paritybyte;
+  }
+
+  uint8_t *c = &out[HORUS_UW_BYTES];
+  uint8_t il[CODED_BYTES];
+  memset(il, 0, sizeof(il));
+  for (uint32_t i = 0; i < CODED_BITS; i++){
+    uint32_t j = (IL_B * i) % CODED_BITS;
+    il[j / 8] |= (uint8_t)(((c[i / 8] >> (i % 8)) & 1u) << (j % 8));
+  }
+  memcpy(c, il, CODED_BYTES);
+
+  uint16_t scrambler = 0x4a80u;
+  for (int i = 0; i < CODED_BITS; i++){
+    uint16_t so = (uint16_t)(((scrambler & 2u) >> 1) ^ (scrambler & 1u));
+    c[i / 8] ^= (uint8_t)(so << (i % 8));
+    scrambler >>= 1;
+    scrambler |= (uint16_t)(so << 14);
+  }
+}
+
+// Golden frame for the selftest telemetry below (seq 1, fix valid). Pinned
+// from this encoder and checked by decoding it back with a separate
+// descramble/deinterleave/Golay/CRC pass (sim/host_horus.c does the same with
+// bit errors); it still wants cross-checking against a frame from
+// horusdemodlib's horus_gen_test_bits.
+static const uint8_t GOLDEN_FRAME[HORUS_V2_FRAME_BYTES] = {
+  0x24,0x24,0xC0,0x7F,0x75,0x31,0xCC,0x17,0xE6,0x49,0x93,0x3D,
+  0xCD,0xB9,0xCF,0xBC,0xF0,0x2C,0x75,0xDC,0x21,0x55,0xE1,0xA4,
+  0x19,0xC7,0xFB,0x83,0x37,0x19,0x60,0xEA,0xC6,0x5A,0x3F,0xD5,
+  0x99,0xDC,0xC3,0x4B,0x3E,0x71,0x30,0x18,0x9A,0xBB,0x3F,0x99,
+  0x5E,0x29,0x6C,0x1D,0x08,0x80,0xA3,0xB2,0xF8,0xEE,0xC8,0xEB,
+  0xB5,0xFD,0x00,0x73,0x75
+};
+
+int horus_selftest(void){
+  int fails = 0;
+
+  // Tables against their definitions
+  static const uint8_t check[] = "123456789";
+  if (horus_crc16(check, 9) != 0x29B1u) fails++;      // the CCITT-FALSE check value
+  for (int i = 0; i < 256; i++){
+    uint8_t b = (uint8_t)i;
+    if (horus_crc16(&b, 1) != ref_crc16(&b, 1)) { fails++; break; }
+  }
+  for (uint32_t d = 0; d < 4096; d++)
+    if (golay_parity((uint16_t)d) != ref_syndrome(d << 11)) { fails++; break; }
+  uint8_t zero[HORUS_V2_FRAME_BYTES] = {0}, sc[HORUS_V2_FRAME_BYTES];
+  ref_encode(zero, sc);       // all-zero payload: its parity is zero too
+  if (memcmp(&sc[HORUS_UW_BYTES], SCRAMBLE, CODED_BYTES)) fails++;
+
+  // Table path against the reference: fixed payloads plus pseudo-random
+  // ones, so every Golay table entry and the tail word get exercised
+  telemetry_t t = {
+    .gps = { .fix_valid = 1, .lat_e7 = -349284000, .lon_e7 = 1386007000, .alt_cm = 1234567,
+             .unix_time = 1780275845u, .sats = 9 },
+    .vbatt_v = 3.71f, .temp_c = -23, .speed_kph = 57 };
+  horus_v2_hdr_t h = { .payload_id = 256, .seq = 1 };
+  uint8_t pl[HORUS_V2_PAYLOAD_BYTES], a[HORUS_V2_FRAME_BYTES], b[HORUS_V2_FRAME_BYTES];
+  uint32_t lcg = 0x1234567u;
+  for (int n = 0; n < 32; n++){
+    if (n < 2){
+      t.gps.fix_valid = !n;
+      horus_pack_v2(&t, &h, pl);
+      if (ref_crc16(pl, 30) != (uint16_t)(pl[30] | pl[31] << 8)) fails++;
+    } else {
+      for (int k = 0; k < HORUS_V2_PAYLOAD_BYTES; k++){
+        lcg = lcg * 1664525u + 1013904223u;
+        pl[k] = (uint8_t)(lcg >> 24);
+      }
+    }
+    horus_encode_frame(pl, a);
+    ref_encode(pl, b);
+    if (memcmp(a, b, sizeof(a))){
+      printf("[HORUS] selftest: frame %d mismatch\n", n);
+      fails++;
+    }
+    if (n == 0 && memcmp(a, GOLDEN_FRAME, sizeof(a))){
+      printf("[HORUS] selftest: golden frame mismatch\n");
+      fails++;
+    }
+  }
+
+  // Symbol packing: preamble, then each frame byte's pairs MSB-first
+  uint8_t sym[HORUS_V2_PACKED_BYTES];
+  horus_build_v2(&t, &h, sym);
+  horus_pack_v2(&t, &h, pl);
+  horus_encode_frame(pl, a);
+  for (int k = 0; k < HORUS_V2_SYMS; k++){
+    int byte = k / 4 - HORUS_PREAMBLE_BYTES;
+    uint8_t v = byte < 0 ? PREAMBLE_BYTE : a[byte];
+    if (horus_packed_sym(sym, k) != ((v >> (6 - 2 * (k % 4))) & 3u)) { fails++; break; }
+  }
+  return fails;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "telemetry.h"
+
+// Horus Binary v2, bit-compatible with horusdemodlib's horus_l2.c:
+//
+//   payload   32 bytes, little-endian fields, CRC16-CCITT over bytes 0..29
+//   frame     "$$" unique word, then payload + Golay(23,12) parity bits,
+//             interleaved and scrambled (the UW is sent in the clear)
+//   symbols   4FSK, two bits per symbol, most significant pair of each byte
+//             first, after a short 0x1B preamble (tones 0,1,2,3 repeating)
+//
+// Symbols come out in the symbol player's packing (2 bits each, symbol k at
+// bits 2*(k%4) of byte k/4), one byte per four symbols.
+
+#define HORUS_V2_PAYLOAD_BYTES 32
+#define HORUS_UW_BYTES         2
+#define HORUS_V2_PARITY_BYTES  31     // 22 codewords * 11 bits, padded
+#define HORUS_V2_FRAME_BYTES   (HORUS_UW_BYTES + HORUS_V2_PAYLOAD_BYTES + HORUS_V2_PARITY_BYTES)  // 65
+#define HORUS_PREAMBLE_BYTES   8
+#define HORUS_V2_PACKED_BYTES  (HORUS_PREAMBLE_BYTES + HORUS_V2_FRAME_BYTES)
+#define HORUS_V2_SYMS          (HORUS_V2_PACKED_BYTES * 4)                          // 292
+#define HORUS_TONES            4
+
+// What goes in the v2 fields that telemetry_t doesn't carry
+typedef struct {
+  uint16_t payload_id;   // from horusdemodlib's payload_id_list.txt
+  uint16_t seq;          // packet counter, wraps
+  uint8_t  custom[9];    // payload-specific bytes (custom_field_list.json); zeros if unused
+} horus_v2_hdr_t;
+
+// 32-byte v2 payload: time from gps.unix_time; position, altitude and sats
+// only with a valid fix (zeros otherwise); battery 0..5 V as 0..255.
+// Out-of-range values are clamped.
+void horus_pack_v2(const telemetry_t *t, const horus_v2_hdr_t *h,
+                   uint8_t out[HORUS_V2_PAYLOAD_BYTES]);
+
+// CRC16-CCITT (poly 0x1021, init 0xFFFF), as the v2 checksum
+uint16_t horus_crc16(const uint8_t *d, size_t n);
+
+// Payload -> "$$" + FEC, interleaved and scrambled (horus_l2_encode_tx_packet)
+void horus_encode_frame(const uint8_t payload[HORUS_V2_PAYLOAD_BYTES],
+                        uint8_t frame[HORUS_V2_FRAME_BYTES]);
+
+// Everything above, preamble included, packed for the symbol player
+void horus_build_v2(const telemetry_t *t, const horus_v2_hdr_t *h,
+                    uint8_t out[HORUS_V2_PACKED_BYTES]);
+static inline uint8_t horus_packed_sym(const uint8_t *p, int k){
+  return (uint8_t)((p[k >> 2] >> ((k & 3) * 2)) & 3u);
+}
+
+// Checks the flash tables against their definitions and the table-driven
+// encoder against a bit-serial port of horus_l2.c; returns the number of
+// failures (0 = pass)
+int horus_selftest(void);
@@ -16,10 +16,46 @@ static const uint8_t SYNC[WSPR_SYMS] = {
   1,1,0,0,0,0,0,1,0,1,0,0,1,1,0,0,0,0,0,0,0,1,1,0,1,0,1,1,0,0,0,1,1,0,0,0
 };
 
+// The same vector packed 2 bits per symbol (wspr_build_packed's layout), so a
+// transmit build starts from a memcpy
+static const uint8_t SYNC_PACKED[WSPR_PACKED_BYTES] = {
+  0x05,0x00,0x01,0x15,0x10,0x44,0x15,0x00,0x10,0x44,0x00,0x10,0x05,0x45,
+  0x40,0x11,0x40,0x11,0x11,0x41,0x10,0x05,0x14,0x11,0x10,0x00,0x41,0x50,
+  0x51,0x50,0x04,0x54,0x00,0x44,0x50,0x00,0x40,0x11,0x05,0x14,0x00
+};
+
+// Interleaver: convolution bit p lands on symbol INTERLEAVE[p], the p-th
+// 8-bit bit-reversed index below 162 (what the spec's loop over 0..255
+// produces). Generated offline; checked by wspr_selftest().
+static const uint8_t INTERLEAVE[WSPR_SYMS] = {
+    0,128, 64, 32,160, 96, 16,144, 80, 48,112,  8,136, 72, 40,104, 24,152,
+   88, 56,120,  4,132, 68, 36,100, 20,148, 84, 52,116, 12,140, 76, 44,108,
+   28,156, 92, 60,124,  2,130, 66, 34, 98, 18,146, 82, 50,114, 10,138, 74,
+   42,106, 26,154, 90, 58,122,  6,134, 70, 38,102, 22,150, 86, 54,118, 14,
+  142, 78, 46,110, 30,158, 94, 62,126,  1,129, 65, 33,161, 97, 17,145, 81,
+   49,113,  9,137, 73, 41,105, 25,153, 89, 57,121,  5,133, 69, 37,101, 21,
+  149, 85, 53,117, 13,141, 77, 45,109, 29,157, 93, 61,125,  3,131, 67, 35,
+   99, 19,147, 83, 51,115, 11,139, 75, 43,107, 27,155, 91, 59,123,  7,135,
+   71, 39,103, 23,151, 87, 55,119, 15,143, 79, 47,111, 31,159, 95, 63,127
+};
+
+// Byte parity, expanded by the preprocessor (256 entries in flash)
+#define P2(n) n, n ^ 1, n ^ 1, n
+#define P4(n) P2(n), P2(n ^ 1), P2(n ^ 1), P2(n)
+#define P6(n) P4(n), P4(n ^ 1), P4(n ^ 1), P4(n)
+static const uint8_t PARITY8[256] = { P6(0), P6(1), P6(1), P6(0) };
+#undef P2
+#undef P4
+#undef P6
+
 // Run-time selectable minute windows (bitmask over even minutes 0..58)
 // Bit n corresponds to minute (2*n). Default {0,2,4,6,8} -> bits 0..4 => 0b1_1111 = 0x1F
 static uint32_t g_minute_mask = 0x1F;
 
+// Message rotation over the enabled windows: position, telemetry, fine position
+static wspr_msg_t g_rot[WSPR_ROT_MAX] = { WSPR_MSG_TYPE1, WSPR_MSG_TELEM, WSPR_MSG_TYPE3 };
+static int g_rot_n = 3;
+
 // ========================= Helpers =========================
 static inline int is_even_minute(int m) { return (m & 1) == 0; }
 
@@ -33,6 +69,42 @@ bool wspr_should_tx_in_minute(int even_minute){
   return (g_minute_mask >> idx) & 1u;
 }
 
+bool wspr_rotation_set(const wspr_msg_t *seq, int n){
+  if (!seq || n < 1 || n > WSPR_ROT_MAX) return false;
+  for (int i = 0; i < n; i++)
+    if (seq[i] < WSPR_MSG_TYPE1 || seq[i] > WSPR_MSG_TELEM) return false;
+  memcpy(g_rot, seq, (size_t)n * sizeof(seq[0]));
+  g_rot_n = n;
+  return true;
+}
+
+int wspr_rotation_get(wspr_msg_t *seq, int max){
+  int n = g_rot_n < max ? g_rot_n : max;
+  if (seq && n > 0) memcpy(seq, g_rot, (size_t)n * sizeof(seq[0]));
+  return g_rot_n;
+}
+
+const char *wspr_msg_name(wspr_msg_t type){
+  static const char *const k_name[] = { "?", "type1", "type2", "type3", "telem" };
+  return (unsigned)type <= WSPR_MSG_TELEM ? k_name[type] : k_name[0];
+}
+
+// Window k (counted over enabled windows since the epoch) sends g_rot[k % n].
+// Types the config can't carry fall back: Type 1 <-> 2 by the callsign's
+// shape, Type 3 to the plain position message without a 6-char grid.
+wspr_msg_t wspr_plan_msg(uint32_t slot_epoch, const wspr_cfg_t *cfg){
+  uint32_t mask = g_minute_mask & 0x3FFFFFFFu;
+  uint32_t slot = (slot_epoch / 120u) % 30u;
+  uint32_t k = (slot_epoch / 3600u) * (uint32_t)__builtin_popcount(mask) +
+               (uint32_t)__builtin_popcount(mask & ((1u << slot) - 1u));
+  wspr_msg_t t = g_rot[k % (uint32_t)g_rot_n];
+  if (!cfg) return t;
+  bool compound = strchr(cfg->callsign, '/') != NULL;
+  if (t == WSPR_MSG_TYPE3 && strlen(cfg->grid) != 6) t = WSPR_MSG_TYPE1;
+  if (t == WSPR_MSG_TYPE1 || t == WSPR_MSG_TYPE2) t = compound ? WSPR_MSG_TYPE2 : WSPR_MSG_TYPE1;
+  return t;
+}
+
 // get bit MSB-first from packed byte array
 static inline int get_bit(const uint8_t *buf, int bit_idx){
   // bit_idx 0 = MSB of buf[0]
@@ -106,9 +178,9 @@ static bool pack_callsign_28(const char *in_callsign, uint32_t *outN){
   return true;
 }
 
-// Pack locator+power into 22 bits M (15+7)
+// Pack locator+power into 22 bits M (15+7); a 6-char grid sends its first 4
 static bool pack_loc_pow_22(const char *grid, int pwr_dbm, uint32_t *outM){
-  if (!grid || strlen(grid)!=4) return false;
+  if (!grid || (strlen(grid)!=4 && strlen(grid)!=6)) return false;
   char L1=toupper(grid[0]), L2=toupper(grid[1]);
   char L3=grid[2], L4=grid[3];
   if (L1<'A'||L1>'R'||L2<'A'||L2>'R'||L3<'0'||L3>'9'||L4<'0'||L4>'9') return false;
@@ -125,6 +197,128 @@ static bool pack_loc_pow_22(const char *grid, int pwr_dbm, uint32_t *outM){
   return true;
 }
 
+// Types 2 and 3 flag themselves through the power field, so only powers
+// ending in 0, 3 or 7 are sendable there (WSJT-X rounds the same way)
+static int round_power(int dbm){
+  static const int8_t nu[10] = { 0,-1,1,0,-1,2,1,0,-1,1 };
+  if (dbm < 0) dbm = 0;
+  if (dbm > 60) dbm = 60;
+  return dbm + nu[dbm % 10];
+}
+
+// Callsign hash for Type 3: Bob Jenkins' lookup3 hashlittle() with seed 146,
+// low 15 bits (WSJT-X nhash). Byte-at-a-time, so no alignment games.
+#define ROT32(x, k) (((x) << (k)) | ((x) >> (32 - (k))))
+static uint32_t call_hash15(const char *call){
+  uint8_t k[12] = {0};
+  size_t len = 0;
+  for (; call[len] && len < 10; len++) k[len] = (uint8_t)toupper((unsigned char)call[len]);
+  uint32_t a, b, c;
+  a = b = c = 0xDEADBEEFu + (uint32_t)len + 146u;
+  if (!len) return c & 0x7FFFu;
+  // <= 12 bytes: only the tail block, zero-padded
+  a += k[0] | (uint32_t)k[1] << 8 | (uint32_t)k[2] << 16 | (uint32_t)k[3] << 24;
+  b += k[4] | (uint32_t)k[5] << 8 | (uint32_t)k[6] << 16 | (uint32_t)k[7] << 24;
+  c += k[8] | (uint32_t)k[9] << 8 | (uint32_t)k[10] << 16 | (uint32_t)k[11] << 24;
+  c ^= b; c -= ROT32(b, 14);
+  a ^= c; a -= ROT32(c, 11);
+  b ^= a; b -= ROT32(a, 25);
+  c ^= b; c -= ROT32(b, 16);
+  a ^= c; a -= ROT32(c, 4);
+  b ^= a; b -= ROT32(a, 14);
+  c ^= b; c -= ROT32(b, 24);
+  return c & 0x7FFFu;
+}
+#undef ROT32
+
+// Type 2: base call in N; the prefix (1-3 chars, base 37, space-padded on
+// the left) or suffix (one char, or two digits) in the 15 bits the grid
+// would use, overflow into the power field's nadd
+static bool pack_type2(const wspr_cfg_t *cfg, uint32_t *outN, uint32_t *outM){
+  const char *cs = cfg->callsign, *sl = strchr(cs, '/');
+  if (!sl || strchr(sl + 1, '/')) return false;
+  size_t pl = (size_t)(sl - cs), sl_len = strlen(sl + 1);
+  char base[7] = {0};
+  uint32_t x;
+  if (sl_len == 1 || (sl_len == 2 && isdigit((unsigned char)sl[1]) && isdigit((unsigned char)sl[2]))){
+    if (pl < 3 || pl > 6) return false;
+    memcpy(base, cs, pl);
+    if (sl_len == 1){
+      int v = chval(toupper((unsigned char)sl[1]));
+      if (v < 0 || v > 35) return false;
+      x = 60000u + (uint32_t)v;
+    } else {
+      uint32_t v = (uint32_t)(10 * (sl[1] - '0') + (sl[2] - '0'));
+      if (v < 10) return false;       // 00..09 would read back as a letter
+      x = 60000u + 26u + v;
+    }
+  } else {
+    if (pl < 1 || pl > 3 || sl_len < 3 || sl_len > 6) return false;
+    memcpy(base, sl + 1, sl_len);
+    x = 0;
+    for (size_t i = 0; i < 3 - pl; i++) x = 37u * x + 36u;
+    for (size_t i = 0; i < pl; i++){
+      int v = chval(toupper((unsigned char)cs[i]));
+      if (v < 0 || v > 35) return false;
+      x = 37u * x + (uint32_t)v;
+    }
+  }
+  if (!pack_callsign_28(base, outN)) return false;
+  uint32_t nadd = x / 32768u;
+  *outM = 128u * (x % 32768u) + (uint32_t)round_power(cfg->power_dbm) + 1u + nadd + 64u;
+  return true;
+}
+
+// Type 3: the 6-char grid rotated left one place ("EN50WC" -> "N50WCE") goes
+// in the callsign field; M = hash * 128 - (power + 1) + 64
+static bool pack_type3(const wspr_cfg_t *cfg, uint32_t *outN, uint32_t *outM){
+  const char *g = cfg->grid;
+  uint32_t m;
+  if (strlen(g) != 6 || !pack_loc_pow_22(g, 0, &m)) return false;
+  for (int i = 4; i < 6; i++){
+    int c = toupper((unsigned char)g[i]);
+    if (c < 'A' || c > 'X') return false;
+  }
+  const char rot[7] = { g[1], g[2], g[3], g[4], g[5], g[0], 0 };
+  if (!pack_callsign_28(rot, outN)) return false;
+  *outM = 128u * call_hash15(cfg->callsign) + 63u - (uint32_t)round_power(cfg->power_dbm);
+  return true;
+}
+
+static uint32_t clampu(int32_t v, int32_t lo, int32_t hi){
+  return (uint32_t)(v < lo ? lo : v > hi ? hi : v);
+}
+
+// Telemetry as a Type 1 frame under a channel callsign (layout: wspr_telem_t)
+static bool pack_telem(const wspr_cfg_t *cfg, const wspr_telem_t *tm, uint32_t *outN, uint32_t *outM){
+  static const char B36[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  static const uint8_t POW19[19] = { 0,3,7,10,13,17,20,23,27,30,33,37,40,43,47,50,53,57,60 };
+  const char *id = cfg->telem_id;
+  if (!tm || !(id[0] == '0' || id[0] == '1' || id[0] == 'Q') || id[1] < '0' || id[1] > '9')
+    return false;
+
+  uint32_t s5 = 11, s6 = 11;          // subsquare centre ("LL") for a 4-char grid
+  if (strlen(cfg->grid) == 6){
+    s5 = (uint32_t)(toupper((unsigned char)cfg->grid[4]) - 'A');
+    s6 = (uint32_t)(toupper((unsigned char)cfg->grid[5]) - 'A');
+    if (s5 > 23 || s6 > 23) return false;
+  }
+  uint32_t v = (s5 * 24u + s6) * 1068u + clampu(tm->alt_m / 20, 0, 1067);
+  const char call[7] = { id[0], B36[v / 17576u], id[1], (char)('A' + v / 676u % 26u),
+                         (char)('A' + v / 26u % 26u), (char)('A' + v % 26u), 0 };
+
+  v = clampu(tm->temp_c + 50, 0, 89);
+  v = v * 40u + ((clampu(tm->volt_mv, 3000, 4950) - 3000u) / 50u + 20u) % 40u;
+  v = v * 42u + clampu(tm->speed_kt / 2, 0, 41);
+  v = v * 2u + (tm->gps_valid ? 1u : 0u);
+  v = v * 2u + (tm->sats_ok ? 1u : 0u);
+  int pwr = POW19[v % 19u];
+  v /= 19u;
+  const char grid[5] = { (char)('A' + v / 1800u), (char)('A' + v / 100u % 18u),
+                         (char)('0' + v / 10u % 10u), (char)('0' + v % 10u), 0 };
+  return pack_callsign_28(call, outN) && pack_loc_pow_22(grid, pwr, outM);
+}
+
 // Build 50-bit payload packed MSB-first in payload50[0..6] (top 50 bits used)
 static void pack_payload50(uint32_t N28, uint32_t M22, uint8_t out[7]){
   // Layout: [N:28 bits][M:22 bits] => total 50
@@ -137,6 +331,11 @@ static void pack_payload50(uint32_t N28, uint32_t M22, uint8_t out[7]){
   }
 }
 
+static inline uint32_t parity32(uint32_t x){
+  x ^= x >> 16; x ^= x >> 8;
+  return PARITY8[x & 0xFFu];
+}
+
 // Convolutional encoder: read 81 bits (50 + 31 zeros) MSB-first from payload+padding
 static void conv_encode_162(const uint8_t payload50[7], uint8_t out162[162]){
   uint32_t r0 = 0, r1 = 0; // shift registers
@@ -152,27 +351,14 @@ static void conv_encode_162(const uint8_t payload50[7], uint8_t out162[162]){
     r1 = (r1 << 1) | (uint32_t)inb;
 
     // parity of (r & POLY)
-    uint32_t x = r0 & POLY0;
-    x ^= x >> 16; x ^= x >> 8; x ^= x >> 4; x ^= x >> 2; x ^= x >> 1;
-    out162[outp++] = (uint8_t)(x & 1u);
-
-    x = r1 & POLY1;
-    x ^= x >> 16; x ^= x >> 8; x ^= x >> 4; x ^= x >> 2; x ^= x >> 1;
-    out162[outp++] = (uint8_t)(x & 1u);
+    out162[outp++] = (uint8_t)parity32(r0 & POLY0);
+    out162[outp++] = (uint8_t)parity32(r1 & POLY1);
   }
 }
 
 // Interleave via bit-reversed addresses
 static void interleave_162(const uint8_t in[162], uint8_t out[162]){
-  int p = 0;
-  for (int i=0;i<256 && p<162;i++){
-    // bit-reverse 8-bit i
-    uint8_t j = (uint8_t)i;
-    j = (uint8_t)(((j * 0x0802u & 0x22110u) | (j * 0x8020u & 0x88440u)) * 0x10101u >> 16);
-    if (j < 162){
-      out[j] = in[p++];
-    }
-  }
+  for (int p=0;p<162;p++) out[INTERLEAVE[p]] = in[p];
 }
 
 // Merge with sync to produce tones
@@ -188,20 +374,99 @@ static void merge_sync_to_symbols(const uint8_t data_inter[162],
 
 bool wspr_build_frame(const wspr_cfg_t *cfg, wspr_frame_t *out){
   if (!cfg || !out) return false;
-  wspr_frame_t z = {0};
   uint32_t N28=0, M22=0;
   if (!pack_callsign_28(cfg->callsign, &N28)) return false;
   if (!pack_loc_pow_22(cfg->grid, cfg->power_dbm, &M22)) return false;
 
-  pack_payload50(N28, M22, z.payload50);
-  conv_encode_162(z.payload50, z.conv162_bits);
-  interleave_162(z.conv162_bits, z.interleaved_bits);
-  merge_sync_to_symbols(z.interleaved_bits, z.symbols, z.sync_bits);
-
-  *out = z;
+  memset(out, 0, sizeof(*out));
+  pack_payload50(N28, M22, out->payload50);
+  conv_encode_162(out->payload50, out->conv162_bits);
+  interleave_162(out->conv162_bits, out->interleaved_bits);
+  merge_sync_to_symbols(out->interleaved_bits, out->symbols, out->sync_bits);
   return true;
 }
 
+// Same pipeline, streamed: each convolution bit goes straight to its
+// interleaved slot, on top of the sync bit already there. A few dozen bytes
+// of stack instead of ~1.3 KB of stage arrays.
+static void encode_packed(uint32_t N28, uint32_t M22, uint8_t out[WSPR_PACKED_BYTES]){
+  memcpy(out, SYNC_PACKED, WSPR_PACKED_BYTES);
+
+  uint64_t v = ((uint64_t)N28 << 22) | M22;   // 50 bits, sent MSB first
+  uint32_t r = 0;
+  const uint8_t *il = INTERLEAVE;
+  for (int i = 0; i < 81; i++){
+    r = (r << 1) | (i < 50 ? (uint32_t)(v >> (49 - i)) & 1u : 0u);
+    uint8_t j = *il++;
+    if (parity32(r & POLY0)) out[j >> 2] |= (uint8_t)(2u << ((j & 3) * 2));
+    j = *il++;
+    if (parity32(r & POLY1)) out[j >> 2] |= (uint8_t)(2u << ((j & 3) * 2));
+  }
+}
+
+bool wspr_build_msg(const wspr_cfg_t *cfg, wspr_msg_t type, const wspr_telem_t *tm,
+                    uint8_t out[WSPR_PACKED_BYTES]){
+  if (!cfg || !out) return false;
+  uint32_t N28=0, M22=0;
+  bool ok;
+  switch (type){
+    case WSPR_MSG_TYPE1:
+      ok = pack_callsign_28(cfg->callsign, &N28) && pack_loc_pow_22(cfg->grid, cfg->power_dbm, &M22);
+      break;
+    case WSPR_MSG_TYPE2: ok = pack_type2(cfg, &N28, &M22); break;
+    case WSPR_MSG_TYPE3: ok = pack_type3(cfg, &N28, &M22); break;
+    case WSPR_MSG_TELEM: ok = pack_telem(cfg, tm, &N28, &M22); break;
+    default:             ok = false; break;
+  }
+  if (ok) encode_packed(N28, M22, out);
+  return ok;
+}
+
+bool wspr_build_packed(const wspr_cfg_t *cfg, uint8_t out[WSPR_PACKED_BYTES]){
+  return wspr_build_msg(cfg, WSPR_MSG_TYPE1, NULL, out);
+}
+
+// ========================= Self-test =========================
+// Golden frames, packed: external references only. K1ABC FN42 37 is the
+// usual reference message (its stream starts 3,3,0,0,2,0,0,0,1,0,2,0,1,3,1,2
+// as published); add wsprsim output here for more callsigns, grids and powers.
+typedef struct { const char *call, *grid; int pwr; uint8_t sym[WSPR_PACKED_BYTES]; } wspr_golden_t;
+static const wspr_golden_t GOLDEN[] = {
+  { "K1ABC", "FN42", 37, {
+      0x0F,0x02,0x21,0x9D,0x1A,0xEC,0xBD,0x22,0xB0,0xE4,0x0A,0xBA,0x85,0x6F,
+      0x68,0x9B,0xCA,0x33,0x93,0x61,0xB2,0x2D,0xBC,0xB3,0x32,0x22,0xE1,0x58,
+      0xF9,0x78,0xA6,0xF6,0x02,0xC4,0xD2,0xAA,0xE2,0xBB,0x2F,0x9C,0x0A } },
+};
+
+int wspr_selftest(void){
+  int fails = 0;
+
+  // Tables against their definitions
+  for (int p = 0, i = 0; i < 256; i++){
+    uint8_t j = (uint8_t)(((i * 0x0802u & 0x22110u) | (i * 0x8020u & 0x88440u)) * 0x10101u >> 16);
+    if (j < WSPR_SYMS && INTERLEAVE[p++] != j) { fails++; break; }
+  }
+  for (int k = 0; k < WSPR_SYMS; k++)
+    if (wspr_packed_sym(SYNC_PACKED, k) != SYNC[k]) { fails++; break; }
+
+  // Both build paths against the golden frames
+  static wspr_frame_t f;
+  for (size_t g = 0; g < sizeof(GOLDEN) / sizeof(GOLDEN[0]); g++){
+    wspr_cfg_t cfg = { .power_dbm = GOLDEN[g].pwr };
+    strncpy(cfg.callsign, GOLDEN[g].call, sizeof(cfg.callsign) - 1);
+    strncpy(cfg.grid, GOLDEN[g].grid, sizeof(cfg.grid) - 1);
+    uint8_t pk[WSPR_PACKED_BYTES];
+    bool ok = wspr_build_packed(&cfg, pk) && !memcmp(pk, GOLDEN[g].sym, sizeof(pk)) &&
+              wspr_build_frame(&cfg, &f);
+    for (int k = 0; ok && k < WSPR_SYMS; k++) ok = f.symbols[k] == wspr_packed_sym(GOLDEN[g].sym, k);
+    if (!ok){
+      printf("[WSPR] selftest: %s %s %d mismatch\n", cfg.callsign, cfg.grid, cfg.power_dbm);
+      fails++;
+    }
+  }
+  return fails;
+}
+
 // Pretty-printers
 static void print_bits_u8_array(const uint8_t *bits, int n){
   for (int i=0;i<n;i++){
@@ -239,7 +504,8 @@ void wspr_print_frame(const wspr_cfg_t *cfg, const wspr_frame_t *f){
 }
 
 
-static void maidenhead_4_from_latlon(double lat, double lon, char out[5]){
+// Field, square and subsquare (EM53NB): ~5 x 2.5 nmi, what Type 3 carries
+static void maidenhead_6_from_latlon(double lat, double lon, char out[7]){
   // Clamp ranges, convert to field/square
   if (lat >  90) lat =  90; if (lat < -90) lat = -90;
   if (lon > 180) lon = 180; if (lon < -180) lon = -180;
@@ -250,15 +516,19 @@ static void maidenhead_4_from_latlon(double lat, double lon, char out[5]){
   int B = (int)(adj_lat / 10.0);
   int C = (int)fmod(adj_lon, 20.0) / 2;  // 0..9
   int D = (int)fmod(adj_lat, 10.0) / 1;  // 0..9
+  int E = (int)(fmod(adj_lon, 2.0) * 12.0);   // 0..23, 5' of longitude
+  int F = (int)(fmod(adj_lat, 1.0) * 24.0);   // 0..23, 2.5' of latitude
 
   out[0] = 'A' + A;
   out[1] = 'A' + B;
   out[2] = '0' + C;
   out[3] = '0' + D;
-  out[4] = 0;
+  out[4] = 'A' + E;
+  out[5] = 'A' + F;
+  out[6] = 0;
 }
 
 void wspr_update_grid_from_latlon(double lat_deg, double lon_deg){
-  char g[5]; maidenhead_4_from_latlon(lat_deg, lon_deg, g);
+  char g[7]; maidenhead_6_from_latlon(lat_deg, lon_deg, g);
   wspr_set_grid(g);
 }
\ No newline at end of file
@@ -5,11 +5,34 @@
 #define WSPR_SYMS 162
 
 typedef struct {
-  char callsign[7];   // up to 6 chars + NUL
-  char grid[5];       // 4 chars + NUL (e.g., EM53)
+  char callsign[11];  // up to 6 chars, or PFX/CALL / CALL/SFX (Type 2) + NUL
+  char grid[7];       // 4 or 6 chars + NUL (e.g., EM53 or EM53NB)
   int  power_dbm;     // 0..60 typical (use 13 for ~20 mW)
+  char telem_id[3];   // telemetry channel id, e.g. "Q0": callsign chars 1 and 3
 } wspr_cfg_t;
 
+// Message types, numbered as in WSJT-X, plus telemetry
+typedef enum {
+  WSPR_MSG_TYPE1 = 1,   // CALL GRID4 PWR
+  WSPR_MSG_TYPE2 = 2,   // PFX/CALL or CALL/SFX PWR (no grid)
+  WSPR_MSG_TYPE3 = 3,   // <CALL> GRID6 PWR, callsign sent as a 15-bit hash
+  WSPR_MSG_TELEM = 4,   // U4B-style basic telemetry in a Type 1 frame
+} wspr_msg_t;
+
+// Telemetry frame contents. Callsign field: telem_id[0], one base-36 char,
+// telem_id[1], three letters carrying the grid subsquare (chars 5-6) and
+// altitude / 20 m. Grid + power carry, most significant first: temperature
+// (-50..39 C), voltage ((V - 3.00) / 0.05 + 20) mod 40, speed / 2 kt (0..41),
+// GPS valid, sats ok. Out-of-range values are clamped.
+typedef struct {
+  int32_t  alt_m;       // 0..21340
+  uint16_t speed_kt;
+  int16_t  temp_c;
+  uint16_t volt_mv;
+  bool     gps_valid;
+  bool     sats_ok;
+} wspr_telem_t;
+
 typedef struct {
   // Stages for inspection/printing
   uint8_t  payload50[7];         // 50-bit payload packed MSB-first across 7 bytes (top 50 bits used)
@@ -19,8 +42,26 @@ typedef struct {
   uint8_t  symbols[WSPR_SYMS];   // 0..3 tones (sync + 2*data)
 } wspr_frame_t;
 
+// Full build with every stage kept: for inspection / wspr_print_frame only
 bool wspr_build_frame(const wspr_cfg_t *cfg, wspr_frame_t *out);
 
+// Transmit build: just the 162 tones, 2 bits each, LSB-first within a byte
+// (symbol k = bits 2*(k%4)..+1 of byte k/4) -- the symbol player's layout
+#define WSPR_PACKED_BYTES ((WSPR_SYMS + 3) / 4)
+bool wspr_build_packed(const wspr_cfg_t *cfg, uint8_t out[WSPR_PACKED_BYTES]);
+// Same, for any message type. Type 3 wants a 6-char grid; Type 2 a compound
+// callsign; telemetry reads tm (and the subsquare from cfg->grid, if any).
+// Power is rounded to the nearest value ending in 0, 3 or 7 for Types 2/3.
+bool wspr_build_msg(const wspr_cfg_t *cfg, wspr_msg_t type, const wspr_telem_t *tm,
+                    uint8_t out[WSPR_PACKED_BYTES]);
+static inline uint8_t wspr_packed_sym(const uint8_t *p, int k){
+  return (uint8_t)((p[k >> 2] >> ((k & 3) * 2)) & 3u);
+}
+
+// Checks the flash tables and both build paths against golden frames;
+// returns the number of failures (0 = pass)
+int wspr_selftest(void);
+
 // Convenience helpers
 void wspr_print_frame(const wspr_cfg_t *cfg, const wspr_frame_t *f);
 uint32_t wspr_minutes_mask_get(void);
@@ -28,9 +69,51 @@ void     wspr_minutes_mask_set(uint32_t mask);
 // helper to decide if this even-UTC minute is one of the enabled windows
 bool wspr_should_tx_in_minute(int even_minute); // pass 0..59 (must be even)
 
+// Message rotation: enabled windows take the types in seq[] in turn, counting
+// windows continuously across hours, so the airtime is the mask's and only
+// the content rotates. Type 1 becomes Type 2 for a compound callsign.
+#define WSPR_ROT_MAX 8
+bool wspr_rotation_set(const wspr_msg_t *seq, int n);
+int  wspr_rotation_get(wspr_msg_t *seq, int max);
+wspr_msg_t wspr_plan_msg(uint32_t slot_epoch, const wspr_cfg_t *cfg);
+const char *wspr_msg_name(wspr_msg_t type);
+
 void wspr_update_grid_from_latlon(double lat_deg, double lon_deg);
 
 // Optional setters exposed for console/GPS integration:
 void wspr_set_callsign(const char *cs);
 void wspr_set_grid(const char *grid);
-void wspr_set_power_dbm(int dbm);
\ No newline at end of file
+void wspr_set_power_dbm(int dbm);
+void wspr_set_telem_id(const char *id);
+// The keyer is called this far ahead of the slot: the DMA sequencer's setup
+// (tone tables, PLL program and reset, 162 bursts, DMA arm) runs before
+// symbol 0, with room for the arbiter's tick-quantised wake-up
+#define WSPR_KEY_LEAD_US 20000u
+// A slot's window: 162 symbols of 8192/12000 s (110.6 s), rounded up
+#define WSPR_WINDOW_US 111000000u
+// wsched, a slot ahead: pick the slot's message and band(s) and build the
+// frame with tm; returns the (first) band's base frequency
+uint32_t wspr_prepare_slot(uint32_t slot_epoch, const wspr_telem_t *tm);
+
+// Band plan (task_wspr.c): each band owns the even minutes in its mask and
+// keys one radio output. A window belongs to the first band listing it; the
+// next band on the other PLL (CLK0 vs CLK1/CLK2) keys the same frame at the
+// same time. The window mask above is kept as the union of the bands'.
+#define WSPR_BANDS_MAX 6
+typedef struct {
+  uint32_t base_hz;       // symbol-0 tone
+  uint32_t minute_mask;   // bit n = even minute 2n; 0 = band off
+  uint8_t  out;           // radio output (SI5351 CLKn)
+} wspr_band_t;
+bool    wspr_band_set(uint8_t i, const wspr_band_t *b);   // i <= count appends
+bool    wspr_band_get(uint8_t i, wspr_band_t *out);
+uint8_t wspr_band_count(void);
+
+// Prebuilt frame cache (task_wspr.c): key-up only swaps a pointer
+typedef struct {
+  uint32_t hits;        // key-ups that found a ready frame for the current inputs
+  uint32_t misses;      // key-ups that had to encode first
+  uint32_t rebuilds;    // encodes, on an input change or a miss
+  uint32_t build_fail;  // inputs the encoder refused (bad call/grid/power)
+} wspr_cache_stats_t;
+void wspr_cache_get_stats(wspr_cache_stats_t *out);
\ No newline at end of file
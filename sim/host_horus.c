@@ -0,0 +1,192 @@
+// sim/host_horus.c -- Horus v2 encoder checks as a host build step.
+//
+// horus_selftest() checks the tables and the table path against a bit-serial
+// port of horus_l2.c's encoder. This goes the other way: it takes the
+// symbols horus_build_v2() emits and runs them through a port of horus_l2.c's
+// receive side (symbols -> bytes, UW, descramble, deinterleave, golay23
+// decode, CRC), after flipping up to 3 bits in every codeword, and then
+// checks each v2 field against what went in. Exits nonzero on any failure.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "horus_encoder.h"
+
+#define CODED_BYTES (HORUS_V2_FRAME_BYTES - HORUS_UW_BYTES)
+#define CODED_BITS  (CODED_BYTES * 8)
+#define IL_B        389u
+#define N_WORDS     22          // 21 full 12-bit groups and the 4-bit tail
+
+static int s_fails;
+
+static void expect(bool ok, const char *what, int n){
+  if (!ok){
+    printf("host_horus: record %d: %s\n", n, what);
+    s_fails++;
+  }
+}
+
+static int get_bit(const uint8_t *b, int i){ return (b[i / 8] >> (7 - i % 8)) & 1; }   // MSB-first
+static int get_bit_lsb(const uint8_t *b, int i){ return (b[i / 8] >> (i % 8)) & 1; }
+
+// ---- receive side, after horus_l2.c ----
+static uint32_t golay_syndrome(uint32_t pattern){
+  uint32_t aux = 1u << 22;
+  if (pattern >= (1u << 11)){
+    while (pattern & 0xFFFFF800u){
+      while (!(aux & pattern)) aux >>= 1;
+      pattern ^= (aux >> 11) * 0xC75u;
+    }
+  }
+  return pattern;
+}
+
+// Nearest codeword; golay23_decode() corrects up to 3 bit errors
+static uint32_t golay_decode(uint32_t rx){
+  uint32_t best = 0, best_d = 24;
+  for (uint32_t d = 0; d < 4096 && best_d; d++){
+    uint32_t cw = (d << 11) | golay_syndrome(d << 11);
+    uint32_t dist = (uint32_t)__builtin_popcount(cw ^ rx);
+    if (dist < best_d) { best_d = dist; best = d; }
+  }
+  return best_d <= 3 ? best : 0xFFFFFFFFu;
+}
+
+static bool rx_decode(const uint8_t *frame, uint8_t payload[HORUS_V2_PAYLOAD_BYTES]){
+  uint8_t c[CODED_BYTES], d[CODED_BYTES];
+  memcpy(c, &frame[HORUS_UW_BYTES], CODED_BYTES);
+
+  uint16_t scrambler = 0x4a80u;
+  for (int i = 0; i < CODED_BITS; i++){
+    uint16_t so = (uint16_t)(((scrambler & 2u) >> 1) ^ (scrambler & 1u));
+    c[i / 8] ^= (uint8_t)(so << (i % 8));
+    scrambler >>= 1;
+    scrambler |= (uint16_t)(so << 14);
+  }
+
+  memset(d, 0, sizeof(d));
+  for (uint32_t i = 0; i < CODED_BITS; i++){
+    uint32_t j = (IL_B * i) % CODED_BITS;
+    d[i / 8] |= (uint8_t)(get_bit_lsb(c, (int)j) << (i % 8));
+  }
+
+  // Data bits MSB-first from the payload, 11 parity bits per group after it
+  memset(payload, 0, HORUS_V2_PAYLOAD_BYTES);
+  const int pbase = HORUS_V2_PAYLOAD_BYTES * 8;
+  for (int w = 0; w < N_WORDS; w++){
+    int nd = w < N_WORDS - 1 ? 12 : 4;
+    uint32_t data = 0, par = 0;
+    for (int k = 0; k < nd; k++) data = (data << 1) | (uint32_t)get_bit(d, w * 12 + k);
+    if (nd == 4) data <<= 1;          // the tail goes in shifted up one
+    for (int k = 0; k < 11; k++) par = (par << 1) | (uint32_t)get_bit(d, pbase + w * 11 + k);
+    uint32_t dec = golay_decode((data << 11) | par);
+    if (dec == 0xFFFFFFFFu) return false;
+    if (nd == 4) dec >>= 1;
+    for (int k = 0; k < nd; k++)
+      if ((dec >> (nd - 1 - k)) & 1u) payload[(w * 12 + k) / 8] |= (uint8_t)(0x80u >> ((w * 12 + k) % 8));
+  }
+
+  uint16_t crc = 0xFFFFu;
+  for (int i = 0; i < HORUS_V2_PAYLOAD_BYTES - 2; i++){
+    crc ^= (uint16_t)(payload[i] << 8);
+    for (int b = 0; b < 8; b++) crc = (crc & 0x8000u) ? (uint16_t)((crc << 1) ^ 0x1021u) : (uint16_t)(crc << 1);
+  }
+  return crc == (uint16_t)(payload[30] | payload[31] << 8);
+}
+
+// ---- one record: build, corrupt, decode, compare ----
+static uint32_t s_lcg = 12345u;
+static uint32_t rnd(uint32_t n){ s_lcg = s_lcg * 1664525u + 1013904223u; return (s_lcg >> 8) % n; }
+
+// Bit position in the coded block (before interleaving) of codeword w's bit
+// k, in the interleaver's LSB-first numbering
+static int coded_pos(int w, int k){
+  int nd = w < N_WORDS - 1 ? 12 : 4;
+  int p = k < nd ? w * 12 + k : HORUS_V2_PAYLOAD_BYTES * 8 + w * 11 + (k - nd);
+  return (p & ~7) | (7 - (p & 7));
+}
+
+static void check_record(int n, const telemetry_t *t, const horus_v2_hdr_t *h){
+  uint8_t sym[HORUS_V2_PACKED_BYTES], bytes[HORUS_V2_PACKED_BYTES], pl[HORUS_V2_PAYLOAD_BYTES];
+  horus_build_v2(t, h, sym);
+
+  // The modem sees symbols; two bits each, first symbol in the top pair
+  for (int i = 0; i < HORUS_V2_PACKED_BYTES; i++){
+    uint8_t b = 0;
+    for (int k = 0; k < 4; k++) b = (uint8_t)((b << 2) | horus_packed_sym(sym, i * 4 + k));
+    bytes[i] = b;
+  }
+  for (int i = 0; i < HORUS_PREAMBLE_BYTES; i++) expect(bytes[i] == 0x1B, "preamble", n);
+  uint8_t *frame = &bytes[HORUS_PREAMBLE_BYTES];
+  expect(frame[0] == '$' && frame[1] == '$', "unique word", n);
+
+  // Clean, then with 1..3 errors in every codeword
+  for (int pass = 0; pass < 2; pass++){
+    uint8_t rx[HORUS_V2_FRAME_BYTES];
+    memcpy(rx, frame, sizeof(rx));
+    for (int w = 0; pass && w < N_WORDS; w++){
+      int nbits = (w < N_WORDS - 1 ? 12 : 4) + 11, used = 0;
+      for (int e = 1 + (int)rnd(3); e > 0; e--){
+        int k;
+        do k = (int)rnd((uint32_t)nbits); while (used & (1 << k));
+        used |= 1 << k;
+        int j = (int)((IL_B * (uint32_t)coded_pos(w, k)) % CODED_BITS);
+        rx[HORUS_UW_BYTES + j / 8] ^= (uint8_t)(1u << (j % 8));
+      }
+    }
+    bool ok = rx_decode(rx, pl);
+    expect(ok, pass ? "decode with bit errors" : "decode", n);
+    if (!ok) return;
+  }
+
+  // Fields, as horusdemodlib unpacks them
+  uint32_t tod = t->gps.unix_time % 86400u;
+  float lat, lon;
+  memcpy(&lat, &pl[7], 4);
+  memcpy(&lon, &pl[11], 4);
+  expect((pl[0] | pl[1] << 8) == h->payload_id, "payload id", n);
+  expect((pl[2] | pl[3] << 8) == h->seq, "counter", n);
+  expect(pl[4] == tod / 3600u && pl[5] == tod / 60u % 60u && pl[6] == tod % 60u, "time", n);
+  if (t->gps.fix_valid){
+    int32_t alt = t->gps.alt_cm / 100;
+    expect(fabs(lat - t->gps.lat_e7 * 1e-7) < 1e-5 && fabs(lon - t->gps.lon_e7 * 1e-7) < 1e-5, "lat/lon", n);
+    expect((pl[15] | pl[16] << 8) == (alt < 0 ? 0 : alt > 65535 ? 65535 : alt), "altitude", n);
+    expect(pl[18] == t->gps.sats, "sats", n);
+  } else {
+    expect(lat == 0.0f && lon == 0.0f && pl[15] == 0 && pl[16] == 0 && pl[18] == 0, "no-fix zeros", n);
+  }
+  expect(pl[17] == (t->speed_kph > 255 ? 255 : t->speed_kph), "speed", n);
+  expect((int8_t)pl[19] == t->temp_c, "temperature", n);
+  int vb = (int)lrintf(t->vbatt_v * (255.0f / 5.0f));
+  expect(pl[20] == (vb < 0 ? 0 : vb > 255 ? 255 : vb), "battery", n);
+  expect(!memcmp(&pl[21], h->custom, sizeof(h->custom)), "custom bytes", n);
+}
+
+int main(void){
+  int st = horus_selftest();
+  if (st) printf("host_horus: horus_selftest() %d failures\n", st);
+  s_fails += st;
+
+  static const telemetry_t k_rec[] = {
+    { .gps = { .fix_valid = 1, .lat_e7 = -349284000, .lon_e7 = 1386007000, .alt_cm = 1234567,
+               .unix_time = 1780275845u, .sats = 9 }, .vbatt_v = 3.71f, .temp_c = -23, .speed_kph = 57 },
+    { .gps = { .fix_valid = 1, .lat_e7 = 899999999, .lon_e7 = -1799999999, .alt_cm = 9000000,
+               .unix_time = 1780358399u, .sats = 255 }, .vbatt_v = 7.0f, .temp_c = 127, .speed_kph = 400 },
+    { .gps = { .fix_valid = 1, .lat_e7 = 0, .lon_e7 = 1, .alt_cm = -5000,
+               .unix_time = 0, .sats = 0 }, .vbatt_v = -1.0f, .temp_c = -128 },
+    { .gps = { .fix_valid = 0, .unix_time = 1780300000u, .sats = 3 }, .vbatt_v = 4.2f, .temp_c = 20 },
+  };
+  int frames = 0;
+  for (int n = 0; n < 400; n++){
+    telemetry_t t = k_rec[n % 4];
+    horus_v2_hdr_t h = { .payload_id = (uint16_t)(256 + n), .seq = (uint16_t)(n * 977u) };
+    for (size_t k = 0; k < sizeof(h.custom); k++) h.custom[k] = (uint8_t)rnd(256);
+    t.gps.unix_time += (uint32_t)n * 7u;
+    check_record(n, &t, &h);
+    frames++;
+  }
+  printf("host_horus: selftest %s, %d frames decoded with up to 3 errors per codeword -> %s\n",
+         st ? "FAIL" : "ok", frames, s_fails ? "FAIL" : "PASS");
+  return s_fails ? EXIT_FAILURE : EXIT_SUCCESS;
+}
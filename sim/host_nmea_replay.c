@@ -0,0 +1,89 @@
+// sim/host_nmea_replay.c -- the 'gps replay' check as a host build step.
+//
+//   nmea_replay [CAPTURE.nmea ...]
+//
+// Runs the built-in corpus (every decoded field against its known value, and
+// the parser counters), then feeds each capture file through a fresh parser:
+// a real receiver log has no expected values, but it must parse with no bad
+// checksums or overlong lines and yield RMC and GGA fixes. malloc/calloc/
+// realloc are wrapped at link time, so "no heap" is measured, not claimed.
+// Exits nonzero on any failure.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gps_nmea.h"
+#include "gps_nmea_replay.h"
+
+#define PASSES 2000
+
+static int s_counting;
+static unsigned long s_allocs;
+
+void *__real_malloc(size_t n);
+void *__real_calloc(size_t n, size_t sz);
+void *__real_realloc(void *p, size_t n);
+void *__wrap_malloc(size_t n){ s_allocs += s_counting; return __real_malloc(n); }
+void *__wrap_calloc(size_t n, size_t sz){ s_allocs += s_counting; return __real_calloc(n, sz); }
+void *__wrap_realloc(void *p, size_t n){ s_allocs += s_counting; return __real_realloc(p, n); }
+
+static uint64_t now_us(void){
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000000u + (uint64_t)t.tv_nsec / 1000u;
+}
+
+static int run_corpus(void){
+  nmea_replay_result_t r;
+  s_allocs = 0;
+  s_counting = 1;
+  nmea_replay_run(PASSES, now_us, &r);
+  s_counting = 0;
+  uint32_t ns_line = r.lines ? (uint32_t)(r.elapsed_us * 1000u / r.lines) : 0;
+  bool ok = r.failures == 0 && r.stats_ok && s_allocs == 0;
+  printf("nmea_replay: corpus %lu passes, %lu lines, %lu ns/line; checks %lu/%lu ok, "
+         "counters %s, %lu allocs -> %s\n",
+         (unsigned long)r.passes, (unsigned long)r.lines, (unsigned long)ns_line,
+         (unsigned long)(r.checks - r.failures), (unsigned long)r.checks,
+         r.stats_ok ? "match" : "MISMATCH", s_allocs, ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
+
+static int run_capture(const char *path){
+  FILE *f = fopen(path, "rb");
+  if (!f){
+    printf("nmea_replay: %s: can't open\n", path);
+    return 1;
+  }
+  static char buf[1 << 20];
+  size_t n = fread(buf, 1, sizeof(buf), f);
+  bool whole = feof(f);
+  fclose(f);
+
+  static nmea_parser_t p;
+  uint32_t rmc = 0, gga = 0;
+  s_allocs = 0;
+  s_counting = 1;
+  nmea_init(&p);
+  for (size_t i = 0; i < n; i++){
+    nmea_event_t ev = nmea_feed(&p, buf[i]);
+    rmc += ev == NMEA_EV_RMC;
+    gga += ev == NMEA_EV_GGA;
+  }
+  s_counting = 0;
+  bool ok = whole && rmc && gga && !p.stats.bad_checksum && !p.stats.overlong && s_allocs == 0;
+  printf("nmea_replay: %s: %lu B%s, %lu RMC %lu GGA, ok=%lu rejected=%lu bad_cksum=%lu "
+         "overlong=%lu, %lu allocs -> %s\n",
+         path, (unsigned long)n, whole ? "" : " (TRUNCATED)", (unsigned long)rmc,
+         (unsigned long)gga, (unsigned long)p.stats.sentences, (unsigned long)p.stats.rejected,
+         (unsigned long)p.stats.bad_checksum, (unsigned long)p.stats.overlong, s_allocs,
+         ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv){
+  int fails = run_corpus();
+  for (int i = 1; i < argc; i++) fails += run_capture(argv[i]);
+  return fails ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,5 @@
+#pragma once
+#include "pico/types.h"
+
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
@@ -0,0 +1,31 @@
+#pragma once
+#include "pico/types.h"
+
+// Only the registers the driver touches. Reading dr after uart_is_readable()
+// returned true yields the next byte, as on the PL011.
+typedef struct {
+  volatile uint32_t dr;
+  volatile uint32_t mis;
+} uart_hw_t;
+
+typedef struct uart_inst uart_inst_t;
+extern uart_inst_t *uart0;
+extern uart_inst_t *uart1;
+
+#define UART0_IRQ               20
+#define UART1_IRQ               21
+#define UART_UARTDR_OE_BITS     0x00000800u
+#define UART_UARTMIS_RTMIS_BITS 0x00000040u
+
+uart_hw_t *uart_get_hw(uart_inst_t *uart);
+uint       uart_get_index(uart_inst_t *uart);
+uint       uart_init(uart_inst_t *uart, uint baudrate);
+void       uart_deinit(uart_inst_t *uart);
+uint       uart_set_baudrate(uart_inst_t *uart, uint baudrate);
+void       uart_set_fifo_enabled(uart_inst_t *uart, bool enabled);
+void       uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data, bool tx_needs_data);
+bool       uart_is_readable(uart_inst_t *uart);
+char       uart_getc(uart_inst_t *uart);
+void       uart_putc_raw(uart_inst_t *uart, char c);
+void       uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len);
+void       uart_tx_wait_blocking(uart_inst_t *uart);
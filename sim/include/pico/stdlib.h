@@ -0,0 +1,11 @@
+#pragma once
+// Host shim for the slice of the Pico SDK the app uses (implemented in sim/sim_hw.c)
+#include "pico/types.h"
+#include "pico/time.h"
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+
+#define PICO_ERROR_TIMEOUT (-1)
+
+void stdio_init_all(void);
+int  getchar_timeout_us(uint32_t timeout_us);   // stdin, non-blocking for 0
@@ -0,0 +1,24 @@
+#pragma once
+// Host shim: boot time is the simulator's virtual clock (FreeRTOS ticks)
+#include "pico/types.h"
+#include "hardware/timer.h"
+
+typedef uint64_t absolute_time_t;
+
+static inline uint64_t        to_us_since_boot(absolute_time_t t){ return t; }
+static inline absolute_time_t from_us_since_boot(uint64_t us){ return us; }
+static inline uint32_t        to_ms_since_boot(absolute_time_t t){ return (uint32_t)(t / 1000u); }
+static inline absolute_time_t get_absolute_time(void){ return time_us_64(); }
+static inline absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us){ return t + us; }
+static inline absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms){ return t + (uint64_t)ms * 1000u; }
+
+// Alarms run on a top-priority "IRQ" task (sim/sim_hw.c); time_us_64()
+// inside the callback reads the target time, i.e. zero IRQ latency.
+typedef int32_t alarm_id_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void *user);
+alarm_id_t add_alarm_at(absolute_time_t t, alarm_callback_t cb, void *user, bool fire_if_past);
+bool       cancel_alarm(alarm_id_t id);
+
+void sleep_until(absolute_time_t t);   // blocks the calling task (or advances time before the scheduler runs)
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
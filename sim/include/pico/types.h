@@ -0,0 +1,7 @@
+#pragma once
+// Host shim: the Pico SDK types this app relies on
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
@@ -0,0 +1,45 @@
+#pragma once
+// Glue between the host shims, the GPS module model and the sim driver.
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "pico/types.h"
+
+#define SIM_SPEED_DEFAULT 20    // real-time divisor for ticks that can't be skipped
+
+extern unsigned g_sim_speed;
+
+// sim_hw.c
+void     vSimSuppressTicksAndSleep(uint32_t idle_ticks);
+uint64_t sim_ticks_skipped(void);
+bool     sim_gpio_driven(uint gpio, bool *level);           // false if never gpio_init()ed
+void     sim_gpio_edge(uint gpio, uint32_t events, uint64_t at_us);
+void     sim_uart_rx(uint index, const uint8_t *data, size_t len, uint baud);
+uint32_t sim_uart_mismatched(uint index);
+
+// sim_gps.c: u-blox module on the GPS UART, PPS pin and power pins
+typedef struct {
+  const char *nmea_path;   // replay this file/pipe instead of the synthetic track
+  uint32_t    epoch0;      // UTC at boot
+  double      ppm;         // crystal error of the simulated board (+ = fast)
+} sim_gps_cfg_t;
+
+typedef struct {
+  uint32_t powerups, pps, cfg_frames;
+  uint32_t baud;           // module UART rate now
+} sim_gps_stats_t;
+
+void   sim_gps_start(const sim_gps_cfg_t *cfg);
+void   sim_gps_uart_tx(const uint8_t *data, size_t len, uint baud);   // host -> module
+double sim_true_utc_s(uint64_t boot_us);                              // ground truth
+void   sim_gps_get_stats(sim_gps_stats_t *out);
+
+// sim_radio.c: radio_hw.h implementation that measures instead of logging
+typedef struct {
+  uint32_t windows;          // enable..disable pairs
+  uint32_t short_windows;    // fewer than WSPR_SYMS tone changes
+  uint32_t freq_sets;
+  int32_t  start_min_us, start_max_us;   // key-up vs true UTC second, signed
+} sim_radio_stats_t;
+
+void sim_radio_get_stats(sim_radio_stats_t *out);
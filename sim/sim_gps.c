@@ -0,0 +1,301 @@
+// sim/sim_gps.c -- u-blox module model behind the GPS UART, PPS and power pins.
+//
+// Powered when LOADSW is low and RESET is released. After a time-to-fix
+// (hot start if it had a fix and BATT_EN kept the backup domain alive), every
+// true-UTC second it raises PPS and then sends RMC+GGA and/or NAV-PVT as
+// configured by CFG-MSG. CFG-PRT moves the module baud; bytes at the wrong
+// rate are lost on both sides. CFG-CFG saves the live config for the next
+// power-up. With --nmea the output is that file's lines instead, one RMC
+// group per second, and the message configuration is ignored.
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "logging.h"
+#include "pico/stdlib.h"
+#include "pico_wspr_horus.h"
+#include "gps_ubx.h"
+#include "sim.h"
+
+#define HOT_TTF_MS    3000u     // + up to 5 s
+#define COLD_TTF_MS   28000u    // + up to 12 s
+#define HOT_MAX_OFF_US 14400000000ULL   // ephemeris kept for 4 h
+
+// synthetic track: drifting east-north-east at float altitude
+#define TRACK_LAT0   45.0
+#define TRACK_LON0  -100.0
+#define TRACK_ALT_M  12000.0
+#define TRACK_VN_MS  3.0
+#define TRACK_VE_MS  20.0
+#define M_PER_DEG    111195.0
+
+typedef struct {
+  uint32_t baud;
+  bool     nmea;              // GGA + RMC
+  bool     pvt;               // NAV-PVT
+} module_cfg_t;
+
+static const module_cfg_t k_default = { UART_GPS_BAUD, true, false };
+
+static sim_gps_cfg_t s_cfg;
+static TaskHandle_t s_task;
+static FILE *s_replay;
+static bool s_replay_pps;
+
+static module_cfg_t s_live, s_saved;
+static bool s_powered, s_had_fix;
+static uint64_t s_fix_at_us, s_off_us;
+static uint32_t s_rng = 0x1234567u;
+static sim_gps_stats_t s_st;
+
+static ubx_parser_t s_host;   // frames the app sends us
+static uint8_t s_reply[256];
+static size_t s_reply_n;
+
+// ---------- true time ----------
+
+static double boot_us_per_s(void){ return 1e6 * (1.0 + s_cfg.ppm * 1e-6); }
+
+double sim_true_utc_s(uint64_t boot_us){ return s_cfg.epoch0 + (double)boot_us / boot_us_per_s(); }
+
+static uint64_t boot_of_utc(uint32_t s){ return (uint64_t)llround((double)(s - s_cfg.epoch0) * boot_us_per_s()); }
+
+// ---------- pins ----------
+
+static uint32_t rnd(uint32_t n){
+  s_rng = s_rng * 1664525u + 1013904223u;
+  return (s_rng >> 8) % n;
+}
+
+static bool track_power(uint64_t now){
+  bool loadsw, reset, batt = false;
+  bool on = sim_gpio_driven(PIN_GPS_LOADSW, &loadsw) && !loadsw &&
+            sim_gpio_driven(PIN_GPS_RESET, &reset) && reset;
+  sim_gpio_driven(PIN_GPS_BATT_EN, &batt);
+
+  if (on && !s_powered){
+    bool hot = s_had_fix && batt && now - s_off_us < HOT_MAX_OFF_US;
+    uint32_t ttf_ms = hot ? HOT_TTF_MS + rnd(5000) : COLD_TTF_MS + rnd(12000);
+    s_fix_at_us = now + (uint64_t)ttf_ms * 1000u;
+    s_live = s_saved;
+    s_reply_n = 0;
+    ubx_init(&s_host);
+    s_st.powerups++;
+  } else if (!on && s_powered){
+    s_off_us = now;
+    if (!batt) s_had_fix = false;
+  }
+  s_powered = on;
+  return on;
+}
+
+static void emit(const void *data, size_t len){
+  sim_uart_rx(uart_get_index(UART_GPS_ID), data, len, s_live.baud);
+}
+
+// ---------- output ----------
+
+static void emit_nmea(const char *body){
+  char out[128];
+  uint8_t ck = 0;
+  for (const char *p = body; *p; p++) ck ^= (uint8_t)*p;
+  int n = snprintf(out, sizeof(out), "$%s*%02X\r\n", body, ck);
+  if (n > 0) emit(out, (size_t)n);
+}
+
+static void fmt_ll(char *out, size_t cap, double deg, bool lat){
+  char hemi = lat ? (deg < 0 ? 'S' : 'N') : (deg < 0 ? 'W' : 'E');
+  double a = fabs(deg);
+  int d = (int)a;
+  snprintf(out, cap, lat ? "%02d%08.5f,%c" : "%03d%08.5f,%c", d, (a - d) * 60.0, hemi);
+}
+
+static void put_u16(uint8_t *p, uint16_t v){ p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static void put_u32(uint8_t *p, uint32_t v){ put_u16(p, (uint16_t)v); put_u16(p + 2, (uint16_t)(v >> 16)); }
+
+static void emit_second(uint32_t s, bool fix){
+  double t = (double)(s - s_cfg.epoch0);
+  double lat = TRACK_LAT0 + TRACK_VN_MS * t / M_PER_DEG;
+  double lon = TRACK_LON0 + TRACK_VE_MS * t / (M_PER_DEG * cos(lat * M_PI / 180.0));
+  lon = fmod(lon + 540.0, 360.0) - 180.0;
+  struct tm tm;
+  time_t tt = (time_t)s;
+  gmtime_r(&tt, &tm);
+
+  if (s_live.nmea){
+    char body[112], la[24], lo[24];
+    if (fix){
+      fmt_ll(la, sizeof(la), lat, true);
+      fmt_ll(lo, sizeof(lo), lon, false);
+      snprintf(body, sizeof(body), "GPRMC,%02d%02d%02d.00,A,%s,%s,%.3f,%.2f,%02d%02d%02d,,,A",
+               tm.tm_hour, tm.tm_min, tm.tm_sec, la, lo,
+               hypot(TRACK_VN_MS, TRACK_VE_MS) * 1.943844,
+               atan2(TRACK_VE_MS, TRACK_VN_MS) * 180.0 / M_PI,
+               tm.tm_mday, tm.tm_mon + 1, tm.tm_year % 100);
+      emit_nmea(body);
+      snprintf(body, sizeof(body), "GPGGA,%02d%02d%02d.00,%s,%s,1,10,0.90,%.1f,M,0.0,M,,",
+               tm.tm_hour, tm.tm_min, tm.tm_sec, la, lo, TRACK_ALT_M);
+      emit_nmea(body);
+    } else {
+      emit_nmea("GPRMC,,V,,,,,,,,,,N");
+      emit_nmea("GPGGA,,,,,,0,00,99.99,,,,,,");
+    }
+  }
+
+  if (s_live.pvt){
+    uint8_t p[UBX_NAV_PVT_LEN] = {0};
+    uint8_t frame[UBX_NAV_PVT_LEN + UBX_OVERHEAD];
+    put_u16(&p[4], (uint16_t)(tm.tm_year + 1900));
+    p[6] = (uint8_t)(tm.tm_mon + 1); p[7] = (uint8_t)tm.tm_mday;
+    p[8] = (uint8_t)tm.tm_hour; p[9] = (uint8_t)tm.tm_min; p[10] = (uint8_t)tm.tm_sec;
+    if (fix){
+      p[11] = 0x07;                                   // date, time, fully resolved
+      put_u32(&p[12], 30);                            // tAcc, ns
+      p[20] = 3; p[21] = 0x01; p[23] = 10;            // 3D, gnssFixOK, 10 SV
+      put_u32(&p[24], (uint32_t)(int32_t)llround(lon * 1e7));
+      put_u32(&p[28], (uint32_t)(int32_t)llround(lat * 1e7));
+      put_u32(&p[32], (uint32_t)(int32_t)(TRACK_ALT_M * 1000.0));
+      put_u32(&p[36], (uint32_t)(int32_t)(TRACK_ALT_M * 1000.0));
+      put_u32(&p[40], 2500);                          // hAcc, mm
+      put_u32(&p[48], (uint32_t)(int32_t)(TRACK_VN_MS * 1000.0));
+      put_u32(&p[52], (uint32_t)(int32_t)(TRACK_VE_MS * 1000.0));
+      put_u32(&p[60], (uint32_t)(int32_t)(hypot(TRACK_VN_MS, TRACK_VE_MS) * 1000.0));
+      put_u16(&p[76], 150);                           // pDOP 1.50
+    }
+    uint16_t n = ubx_frame(UBX_CLS_NAV, UBX_NAV_PVT, p, sizeof(p), frame, sizeof(frame));
+    if (n) emit(frame, n);
+  }
+}
+
+// one RMC group of the replay file per second; PPS only after a valid RMC
+static void replay_second(uint64_t at){
+  if (s_replay_pps){
+    sim_gpio_edge(PIN_GPS_PPS, GPIO_IRQ_EDGE_RISE, at);
+    s_st.pps++;
+  }
+  char line[160];
+  while (fgets(line, sizeof(line), s_replay)){
+    emit(line, strlen(line));
+    if (strstr(line, "RMC,")){
+      s_replay_pps = strstr(line, ",A,") != NULL;
+      return;
+    }
+  }
+  LOGI("sim: NMEA replay finished");
+  fclose(s_replay);
+  s_replay = NULL;
+  s_replay_pps = false;
+}
+
+static void on_second(uint32_t s, uint64_t at){
+  taskENTER_CRITICAL();
+  bool on = track_power(at);
+  taskEXIT_CRITICAL();
+  if (!on) return;
+
+  if (s_cfg.nmea_path){
+    if (s_replay) replay_second(at);
+    return;
+  }
+  bool fix = at >= s_fix_at_us;
+  if (fix){
+    s_had_fix = true;
+    sim_gpio_edge(PIN_GPS_PPS, GPIO_IRQ_EDGE_RISE, at);
+    s_st.pps++;
+  }
+  emit_second(s, fix);
+}
+
+// ---------- host -> module ----------
+
+static void reply(uint8_t cls, uint8_t id, const uint8_t *pl, uint16_t len){
+  s_reply_n += ubx_frame(cls, id, pl, len, s_reply + s_reply_n,
+                         (uint16_t)(sizeof(s_reply) - s_reply_n));
+}
+
+static void on_host_frame(const ubx_parser_t *u){
+  if (u->cls != UBX_CLS_CFG) return;
+  s_st.cfg_frames++;
+  const uint8_t ack[2] = { u->cls, u->id };
+
+  switch (u->id){
+  case UBX_CFG_PRT:
+    if (u->len == 20){
+      // switches immediately; the ACK would go out at the new rate and be lost
+      s_live.baud = (uint32_t)u->payload[8] | (uint32_t)u->payload[9] << 8 |
+                    (uint32_t)u->payload[10] << 16 | (uint32_t)u->payload[11] << 24;
+      return;
+    }
+    break;                                  // poll: the ACK is all the driver looks at
+  case UBX_CFG_MSG:
+    if (u->len < 3) break;
+    if (u->payload[0] == UBX_CLS_NAV && u->payload[1] == UBX_NAV_PVT)
+      s_live.pvt = u->payload[2] != 0;
+    else if (u->payload[0] == UBX_CLS_NMEA && (u->payload[1] == 0x00 || u->payload[1] == 0x04))
+      s_live.nmea = u->payload[2] != 0;     // GGA/RMC; the rest aren't modelled
+    break;
+  case UBX_CFG_CFG:
+    s_saved = s_live;
+    break;
+  default:
+    break;
+  }
+  reply(UBX_CLS_ACK, UBX_ACK_ACK, ack, sizeof(ack));
+}
+
+void sim_gps_uart_tx(const uint8_t *data, size_t len, uint baud){
+  taskENTER_CRITICAL();
+  if (track_power(time_us_64()) && baud == s_live.baud){
+    for (size_t i = 0; i < len; i++)
+      if (ubx_feed(&s_host, data[i])) on_host_frame(&s_host);
+  }
+  bool wake = s_reply_n != 0;
+  taskEXIT_CRITICAL();
+  // the model task is higher priority: replies go out before we return
+  if (wake && s_task) xTaskNotifyGive(s_task);
+}
+
+static void flush_replies(void){
+  uint8_t buf[sizeof(s_reply)];
+  taskENTER_CRITICAL();
+  size_t n = s_reply_n;
+  memcpy(buf, s_reply, n);
+  s_reply_n = 0;
+  taskEXIT_CRITICAL();
+  if (n) emit(buf, n);
+}
+
+// ---------- model task ----------
+
+static void sim_gps_task(void *arg){
+  (void)arg;
+  uint32_t s = (uint32_t)sim_true_utc_s(time_us_64()) + 1u;
+
+  for (;;){
+    uint64_t at = boot_of_utc(s);
+    uint64_t now = time_us_64();
+    if (now < at) ulTaskNotifyTake(pdTRUE, (TickType_t)((at - now + 999u) / 1000u));
+    flush_replies();
+    if (time_us_64() >= at){
+      on_second(s, at);
+      s++;
+    }
+  }
+}
+
+void sim_gps_get_stats(sim_gps_stats_t *out){
+  *out = s_st;
+  out->baud = s_live.baud;
+}
+
+void sim_gps_start(const sim_gps_cfg_t *cfg){
+  s_cfg = *cfg;
+  s_live = s_saved = k_default;
+  ubx_init(&s_host);
+  if (s_cfg.nmea_path && !(s_replay = fopen(s_cfg.nmea_path, "r")))
+    LOGE("sim: can't open %s", s_cfg.nmea_path);
+  xTaskCreate(sim_gps_task, "simgps", 1024, NULL, configMAX_PRIORITIES - 2, &s_task);
+}
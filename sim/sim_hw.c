@@ -0,0 +1,308 @@
+// sim/sim_hw.c -- Pico SDK shims for the host build: virtual clock, GPIO,
+// IRQ table, UART RX FIFO, stdio console.
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "pico_wspr_horus.h"
+#include "sim.h"
+
+// ---------- virtual clock ----------
+// Boot time is derived from the tick count, so it only moves when FreeRTOS
+// time moves. Tickless idle (portSUPPRESS_TICKS_AND_SLEEP) jumps the tick
+// count straight to the next wake-up, which is what makes idle hours cost
+// nothing. Before the scheduler runs, sleep_ms() just advances an offset.
+
+unsigned g_sim_speed = SIM_SPEED_DEFAULT;
+
+static uint64_t s_pre_us = 0;         // time spent in sleep_*() before the scheduler
+// nonzero: time_us_64() inside a simulated ISR. Each task is a pthread in
+// the POSIX port, so thread-local keeps one "ISR" preempting another honest.
+static _Thread_local uint64_t s_irq_us = 0;
+static uint64_t s_ticks_skipped = 0;
+
+uint64_t time_us_64(void){
+  if (s_irq_us) return s_irq_us;
+  if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) return s_pre_us;
+  // unsigned difference: correct across a TickType_t wrap (runs < 49 days)
+  uint32_t ticks = (uint32_t)(xTaskGetTickCount() - (TickType_t)configINITIAL_TICK_COUNT);
+  return s_pre_us + (uint64_t)ticks * (1000000u / configTICK_RATE_HZ);
+}
+
+uint32_t time_us_32(void){ return (uint32_t)time_us_64(); }
+
+void sleep_until(absolute_time_t t){
+  uint64_t now = time_us_64();
+  if (t <= now) return;
+  if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED){
+    s_pre_us = t;
+    return;
+  }
+  // round up: like the SDK, never return before t
+  const uint64_t tick_us = 1000000u / configTICK_RATE_HZ;
+  vTaskDelay((TickType_t)((t - now + tick_us - 1u) / tick_us));
+}
+
+void sleep_us(uint64_t us){ sleep_until(time_us_64() + us); }
+void sleep_ms(uint32_t ms){ sleep_us((uint64_t)ms * 1000u); }
+
+void vSimSuppressTicksAndSleep(TickType_t idle){
+  // Called by the idle task with the scheduler suspended. Stop one tick
+  // short; the next real tick unblocks whoever is due.
+  if (idle < 2) return;
+  vTaskStepTick(idle - 1);
+  s_ticks_skipped += idle - 1;
+}
+
+uint64_t sim_ticks_skipped(void){ return s_ticks_skipped; }
+
+// The POSIX port paces its tick with usleep() (V11) or setitimer() (V10);
+// both are wrapped at link time so --speed also shortens the busy stretches
+// tickless idle can't skip.
+int __real_usleep(useconds_t us);
+int __wrap_usleep(useconds_t us){
+  us /= g_sim_speed;
+  return __real_usleep(us ? us : 1);
+}
+
+int __real_setitimer(int which, const struct itimerval *nv, struct itimerval *ov);
+static void scale_tv(struct timeval *tv){
+  uint64_t us = (uint64_t)tv->tv_sec * 1000000u + (uint64_t)tv->tv_usec;
+  if (!us) return;
+  us /= g_sim_speed;
+  if (!us) us = 1;
+  tv->tv_sec = (time_t)(us / 1000000u);
+  tv->tv_usec = (suseconds_t)(us % 1000000u);
+}
+int __wrap_setitimer(int which, const struct itimerval *nv, struct itimerval *ov){
+  if (!nv) return __real_setitimer(which, nv, ov);
+  struct itimerval v = *nv;
+  scale_tv(&v.it_interval);
+  scale_tv(&v.it_value);
+  return __real_setitimer(which, &v, ov);
+}
+
+// ---------- alarms ----------
+// Stand-in for the SDK alarm pool: a top-priority task plays the timer IRQ.
+#define SIM_ALARMS 4
+
+typedef struct { alarm_id_t id; uint64_t at; alarm_callback_t cb; void *user; } sim_alarm_t;
+
+static sim_alarm_t s_alarm[SIM_ALARMS];
+static alarm_id_t s_alarm_id = 0;
+static TaskHandle_t s_alarm_task;
+
+static void sim_alarm_task(void *arg){
+  (void)arg;
+  const uint64_t tick_us = 1000000u / configTICK_RATE_HZ;
+  for (;;){
+    int k = -1;
+    taskENTER_CRITICAL();
+    for (int i = 0; i < SIM_ALARMS; i++)
+      if (s_alarm[i].cb && (k < 0 || s_alarm[i].at < s_alarm[k].at)) k = i;
+    sim_alarm_t a = k >= 0 ? s_alarm[k] : (sim_alarm_t){0};
+    taskEXIT_CRITICAL();
+
+    uint64_t now = time_us_64();
+    if (k < 0 || a.at > now){
+      ulTaskNotifyTake(pdTRUE, k < 0 ? portMAX_DELAY : (TickType_t)((a.at - now + tick_us - 1u) / tick_us));
+      continue;
+    }
+    s_irq_us = a.at;
+    int64_t r = a.cb(a.id, a.user);
+    s_irq_us = 0;
+
+    taskENTER_CRITICAL();
+    if (s_alarm[k].id == a.id){   // not cancelled meanwhile
+      if (r < 0) s_alarm[k].at = a.at + (uint64_t)(-r);
+      else if (r > 0) s_alarm[k].at = time_us_64() + (uint64_t)r;
+      else s_alarm[k].cb = NULL;
+    }
+    taskEXIT_CRITICAL();
+  }
+}
+
+alarm_id_t add_alarm_at(absolute_time_t t, alarm_callback_t cb, void *user, bool fire_if_past){
+  if (!cb || (!fire_if_past && t <= time_us_64())) return 0;
+  if (!s_alarm_task)
+    xTaskCreate(sim_alarm_task, "simirq", 1024, NULL, configMAX_PRIORITIES - 1, &s_alarm_task);
+  alarm_id_t id = -1;
+  taskENTER_CRITICAL();
+  for (int i = 0; i < SIM_ALARMS; i++){
+    if (!s_alarm[i].cb){
+      if (++s_alarm_id <= 0) s_alarm_id = 1;
+      s_alarm[i] = (sim_alarm_t){ s_alarm_id, t, cb, user };
+      id = s_alarm_id;
+      break;
+    }
+  }
+  taskEXIT_CRITICAL();
+  if (id > 0) xTaskNotifyGive(s_alarm_task);
+  return id;
+}
+
+bool cancel_alarm(alarm_id_t id){
+  bool found = false;
+  taskENTER_CRITICAL();
+  for (int i = 0; i < SIM_ALARMS; i++){
+    if (s_alarm[i].cb && s_alarm[i].id == id){ s_alarm[i].cb = NULL; found = true; }
+  }
+  taskEXIT_CRITICAL();
+  return found;
+}
+
+// ---------- GPIO ----------
+#define SIM_NGPIO 30
+
+static bool s_gpio_init[SIM_NGPIO];
+static bool s_gpio_out[SIM_NGPIO];
+static uint32_t s_gpio_irq_mask[SIM_NGPIO];
+static gpio_irq_callback_t s_gpio_cb;
+
+void gpio_init(uint gpio){ if (gpio < SIM_NGPIO){ s_gpio_init[gpio] = true; s_gpio_out[gpio] = false; } }
+void gpio_set_dir(uint gpio, bool out){ (void)gpio; (void)out; }
+void gpio_put(uint gpio, bool value){ if (gpio < SIM_NGPIO) s_gpio_out[gpio] = value; }
+bool gpio_get(uint gpio){ return gpio < SIM_NGPIO && s_gpio_out[gpio]; }
+void gpio_set_function(uint gpio, enum gpio_function fn){ (void)gpio; (void)fn; }
+void gpio_pull_up(uint gpio){ (void)gpio; }
+
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled){
+  if (gpio >= SIM_NGPIO) return;
+  if (enabled) s_gpio_irq_mask[gpio] |= events;
+  else s_gpio_irq_mask[gpio] &= ~events;
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled,
+                                        gpio_irq_callback_t callback){
+  gpio_set_irq_enabled(gpio, events, enabled);
+  if (callback) s_gpio_cb = callback;
+}
+
+bool sim_gpio_driven(uint gpio, bool *level){
+  if (gpio >= SIM_NGPIO || !s_gpio_init[gpio]) return false;
+  *level = s_gpio_out[gpio];
+  return true;
+}
+
+void sim_gpio_edge(uint gpio, uint32_t events, uint64_t at_us){
+  if (gpio >= SIM_NGPIO || !s_gpio_cb || !(s_gpio_irq_mask[gpio] & events)) return;
+  // zero IRQ latency: the ISR's time_us_64() reads the edge time itself,
+  // not the millisecond tick the model task woke on
+  s_irq_us = at_us;
+  s_gpio_cb(gpio, events & s_gpio_irq_mask[gpio]);
+  s_irq_us = 0;
+}
+
+// ---------- IRQ table ----------
+#define SIM_NIRQ 32
+
+static irq_handler_t s_irq_handler[SIM_NIRQ];
+static bool s_irq_enabled[SIM_NIRQ];
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler){ if (num < SIM_NIRQ) s_irq_handler[num] = handler; }
+void irq_remove_handler(uint num, irq_handler_t handler){
+  if (num < SIM_NIRQ && s_irq_handler[num] == handler) s_irq_handler[num] = NULL;
+}
+void irq_set_enabled(uint num, bool enabled){ if (num < SIM_NIRQ) s_irq_enabled[num] = enabled; }
+bool irq_is_enabled(uint num){ return num < SIM_NIRQ && s_irq_enabled[num]; }
+void irq_set_priority(uint num, uint8_t priority){ (void)num; (void)priority; }
+
+// ---------- UART ----------
+#define SIM_UART_FIFO 32    // PL011 RX FIFO depth
+
+struct uart_inst {
+  uint      index;
+  uint      baud;           // 0 = not initialised
+  bool      rx_irq;
+  uart_hw_t hw;
+  uint8_t   fifo[SIM_UART_FIFO];
+  uint8_t   head, count;
+  uint32_t  mismatched;     // bytes sent at the wrong baud (framing errors on HW)
+};
+
+static struct uart_inst s_uart[2] = { { .index = 0 }, { .index = 1 } };
+uart_inst_t *uart0 = &s_uart[0];
+uart_inst_t *uart1 = &s_uart[1];
+
+uart_hw_t *uart_get_hw(uart_inst_t *uart){ return &uart->hw; }
+uint uart_get_index(uart_inst_t *uart){ return uart->index; }
+uint uart_init(uart_inst_t *uart, uint baudrate){ uart->baud = baudrate; uart->count = 0; return baudrate; }
+void uart_deinit(uart_inst_t *uart){ uart->baud = 0; uart->rx_irq = false; uart->count = 0; }
+uint uart_set_baudrate(uart_inst_t *uart, uint baudrate){ uart->baud = baudrate; return baudrate; }
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled){ (void)uart; (void)enabled; }
+void uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data, bool tx_needs_data){
+  (void)tx_needs_data;
+  uart->rx_irq = rx_has_data;
+}
+
+bool uart_is_readable(uart_inst_t *uart){
+  if (!uart->count) return false;
+  uart->hw.dr = uart->fifo[uart->head];
+  uart->head = (uint8_t)((uart->head + 1u) % SIM_UART_FIFO);
+  uart->count--;
+  return true;
+}
+
+char uart_getc(uart_inst_t *uart){
+  while (!uart_is_readable(uart)) vTaskDelay(1);
+  return (char)uart->hw.dr;
+}
+
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len){
+  if (uart->baud && uart == UART_GPS_ID) sim_gps_uart_tx(src, len, uart->baud);
+}
+void uart_putc_raw(uart_inst_t *uart, char c){ uart_write_blocking(uart, (const uint8_t *)&c, 1); }
+void uart_tx_wait_blocking(uart_inst_t *uart){ (void)uart; }
+
+// One FIFO-full at a time, IRQ after each; RX timeout flagged on the last
+// chunk of the burst, the way the PL011 reports a line going idle.
+void sim_uart_rx(uint index, const uint8_t *data, size_t len, uint baud){
+  struct uart_inst *u = &s_uart[index & 1u];
+  if (!u->baud || baud != u->baud){ u->mismatched += (uint32_t)len; return; }
+  uint irq = UART0_IRQ + u->index;
+
+  while (len){
+    size_t n = 0;
+    while (n < len && u->count < SIM_UART_FIFO){
+      u->fifo[(u->head + u->count) % SIM_UART_FIFO] = data[n++];
+      u->count++;
+    }
+    data += n; len -= n;
+    u->hw.mis = len ? 0 : UART_UARTMIS_RTMIS_BITS;
+    if (u->rx_irq && s_irq_enabled[irq] && s_irq_handler[irq]) s_irq_handler[irq]();
+    if (n == 0 && u->count == SIM_UART_FIFO){
+      // nobody drained it: drop the rest like an overrun would
+      u->count = 0;
+      break;
+    }
+  }
+  u->hw.mis = 0;
+}
+
+uint32_t sim_uart_mismatched(uint index){ return s_uart[index & 1u].mismatched; }
+
+// ---------- stdio ----------
+
+void stdio_init_all(void){
+  setvbuf(stdout, NULL, _IOLBF, 0);
+  fcntl(0, F_SETFL, fcntl(0, F_GETFL) | O_NONBLOCK);
+}
+
+int getchar_timeout_us(uint32_t timeout_us){
+  (void)timeout_us;
+  unsigned char c;
+  ssize_t n = read(0, &c, 1);
+  if (n == 1) return c;
+  if (n == 0){
+    // stdin closed: nothing will ever arrive, so park the console instead
+    // of letting its 10 ms poll defeat tickless idle
+    vTaskSuspend(NULL);
+  }
+  return PICO_ERROR_TIMEOUT;
+}
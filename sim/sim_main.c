@@ -0,0 +1,148 @@
+// sim/sim_main.c -- host entry point: parse options, start the GPS model and
+// a supervisor, then hand over to the firmware's main() (built as app_main).
+//
+//   balloon_sim [--hours H] [--speed N] [--start EPOCH] [--ppm X] [--nmea FILE]
+//
+// After H virtual hours the supervisor prints a summary and exits nonzero if
+// a window was lost (rejected, preempted or missed), started off its second,
+// sent a short frame, or a queue dropped something.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "logging.h"
+#include "pico/stdlib.h"
+#include "pico_wspr_horus.h"
+#include "msg_bus.h"
+#include "timebase.h"
+#include "radio_arbiter.h"
+#include "gps_hw.h"
+#include "wspr_encoder.h"
+#include "tasks/task_gps.h"
+#include "sim.h"
+
+#define SIM_START_DEFAULT 1780272000u   // 2026-06-01 00:00:00 UTC
+#define SIM_MAX_START_US  100000        // key-up tolerance vs the true second
+
+int app_main(void);
+
+static uint32_t s_hours = 24;
+
+static void usage(const char *argv0){
+  fprintf(stderr, "usage: %s [--hours H] [--speed N] [--start EPOCH] [--ppm X] [--nmea FILE]\n"
+                  "  stdin is the console; redirect it from /dev/null for batch runs\n", argv0);
+  exit(2);
+}
+
+static void print_summary(double real_s){
+  msg_chan_stats_t fix, tx;
+  gps_pwr_stats_t pwr;
+  gps_rx_stats_t rx;
+  timebase_status_t tb;
+  radio_arbiter_stats_t arb;
+  sim_radio_stats_t rad;
+  sim_gps_stats_t mod;
+  wspr_cache_stats_t wc;
+  msg_bus_get_stats(&fix, &tx);
+  wspr_cache_get_stats(&wc);
+  gps_pwr_get_stats(&pwr);
+  gps_rx_get_stats(&rx);
+  timebase_get_status(&tb);
+  radio_arbiter_get_stats(&arb);
+  sim_radio_get_stats(&rad);
+  sim_gps_get_stats(&mod);
+  radio_mode_stats_t m = {0};
+  for (int i = 0; i < RADIO_MODES; i++){
+    m.admitted += arb.mode[i].admitted;
+    m.rejected += arb.mode[i].rejected + arb.mode[i].preempted + arb.mode[i].missed;
+    m.windows  += arb.mode[i].windows;
+  }
+
+  printf("\n==== sim: %lu h virtual in %.1f s real (%llu ticks skipped) ====\n",
+         (unsigned long)s_hours, real_s, (unsigned long long)sim_ticks_skipped());
+  printf("radio   : %lu windows (%lu short); arbiter %lu admitted, %lu run, %lu lost, late max %lu us, calendar max %u\n",
+         (unsigned long)rad.windows, (unsigned long)rad.short_windows,
+         (unsigned long)m.admitted, (unsigned long)m.windows, (unsigned long)m.rejected,
+         (unsigned long)arb.late.max_us, arb.booked_max);
+  printf("key-up  : %+ld .. %+ld us from the true second\n",
+         (long)rad.start_min_us, (long)rad.start_max_us);
+  printf("wspr    : frame cache %lu hits, %lu misses, %lu rebuilds\n",
+         (unsigned long)wc.hits, (unsigned long)wc.misses, (unsigned long)wc.rebuilds);
+  printf("bus     : fix %lu pub, tx %lu pub %lu drop (deepest %lu)\n",
+         (unsigned long)fix.publishes, (unsigned long)tx.publishes,
+         (unsigned long)tx.drops, (unsigned long)tx.max_lag);
+  printf("gps rx  : %lu B, %lu dropped, %lu overruns, ring hwm %u, %lu B at wrong baud\n",
+         (unsigned long)rx.rx_bytes, (unsigned long)rx.dropped, (unsigned long)rx.overruns,
+         rx.ring_hwm, (unsigned long)sim_uart_mismatched(uart_get_index(UART_GPS_ID)));
+  printf("gps pwr : %lu cycles, %lu misses, %lu skips, lead %lu s, module %lu powerups %lu pps @%lu\n",
+         (unsigned long)pwr.cycles, (unsigned long)pwr.misses, (unsigned long)pwr.skips,
+         (unsigned long)pwr.lead_s, (unsigned long)mod.powerups, (unsigned long)mod.pps,
+         (unsigned long)mod.baud);
+  printf("clock   : %s ppb=%ld +/-%lu err=%lu us, %lu steps %lu slews\n",
+         tb.valid ? "valid" : "INVALID", (long)tb.ppb, (unsigned long)tb.ppb_unc,
+         (unsigned long)tb.err_us, (unsigned long)tb.steps, (unsigned long)tb.slews);
+}
+
+static bool summary_ok(void){
+  msg_chan_stats_t fix, tx;
+  gps_rx_stats_t rx;
+  sim_radio_stats_t rad;
+  radio_arbiter_stats_t arb;
+  msg_bus_get_stats(&fix, &tx);
+  gps_rx_get_stats(&rx);
+  sim_radio_get_stats(&rad);
+  radio_arbiter_get_stats(&arb);
+  // every booked window of every mode must have run
+  uint32_t lost = 0;
+  for (int i = 0; i < RADIO_MODES; i++)
+    lost += arb.mode[i].rejected + arb.mode[i].preempted + arb.mode[i].missed;
+  return rad.windows > 0 && rad.short_windows == 0 && lost == 0 &&
+         rad.start_min_us > -SIM_MAX_START_US && rad.start_max_us < SIM_MAX_START_US &&
+         tx.drops == 0 && rx.dropped == 0 && rx.overruns == 0;
+}
+
+static void sim_supervisor_task(void *arg){
+  (void)arg;
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+
+  for (uint32_t h = 0; h < s_hours; h++){
+    vTaskDelay(pdMS_TO_TICKS(3600000u));
+    sim_radio_stats_t rad;
+    sim_radio_get_stats(&rad);
+    LOGI("sim: hour %lu done, %lu windows", (unsigned long)(h + 1), (unsigned long)rad.windows);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  print_summary((double)(t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9);
+  bool ok = summary_ok();
+  printf("==== sim: %s ====\n", ok ? "PASS" : "FAIL");
+  fflush(stdout);
+  exit(ok ? 0 : 1);
+}
+
+int main(int argc, char **argv){
+  sim_gps_cfg_t gps = { .epoch0 = SIM_START_DEFAULT };
+
+  for (int i = 1; i < argc; i++){
+    const char *a = argv[i];
+    const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+    if (!v) usage(argv[0]);
+    if      (!strcmp(a, "--hours")) s_hours = (uint32_t)strtoul(v, NULL, 0);
+    else if (!strcmp(a, "--speed")) g_sim_speed = (unsigned)strtoul(v, NULL, 0);
+    else if (!strcmp(a, "--start")) gps.epoch0 = (uint32_t)strtoul(v, NULL, 0);
+    else if (!strcmp(a, "--ppm"))   gps.ppm = strtod(v, NULL);
+    else if (!strcmp(a, "--nmea"))  gps.nmea_path = v;
+    else usage(argv[0]);
+    i++;
+  }
+  if (!g_sim_speed) g_sim_speed = 1;
+  if (!s_hours) s_hours = 1;
+
+  sim_gps_start(&gps);
+  xTaskCreate(sim_supervisor_task, "simsup", 1024, NULL, configMAX_PRIORITIES - 2, NULL);
+  return app_main();
+}
@@ -0,0 +1,119 @@
+// src/app_rtos.c
+#include "app_rtos.h"
+#include "logging.h"
+#include <string.h>
+#if PICO_ON_DEVICE
+#include <malloc.h>
+#include "hardware/regs/addressmap.h"
+#endif
+
+typedef struct {
+  const char  *name;
+  TaskHandle_t task;        // NULL for non-task objects, and idle/timer until looked up
+  uint32_t     stack_words; // tasks only
+  uint32_t     bytes;
+} app_obj_t;
+
+static app_obj_t s_obj[APP_RTOS_OBJECTS_MAX];
+static uint8_t s_n_obj;
+
+static void obj_add(const char *name, TaskHandle_t t, uint32_t words, size_t bytes){
+  taskENTER_CRITICAL();
+  configASSERT(s_n_obj < APP_RTOS_OBJECTS_MAX);
+  if (s_n_obj < APP_RTOS_OBJECTS_MAX)
+    s_obj[s_n_obj++] = (app_obj_t){ name, t, words, (uint32_t)bytes };
+  taskEXIT_CRITICAL();
+}
+
+TaskHandle_t app_task_create(TaskFunction_t fn, const char *name, void *arg, UBaseType_t prio,
+                             StackType_t *stack, uint32_t stack_words, StaticTask_t *tcb){
+  TaskHandle_t t = xTaskCreateStatic(fn, name, stack_words, arg, prio, stack, tcb);
+  configASSERT(t);
+  obj_add(name, t, stack_words, stack_words * sizeof(StackType_t) + sizeof(StaticTask_t));
+  return t;
+}
+
+void app_rtos_register(const char *name, size_t bytes){
+  obj_add(name, NULL, 0, bytes);
+}
+
+// The kernel's own tasks, static like the rest
+void vApplicationGetIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack, uint32_t *words){
+  static StaticTask_t s_tcb;
+  static StackType_t s_stack[configMINIMAL_STACK_SIZE];
+  *tcb = &s_tcb;
+  *stack = s_stack;
+  *words = configMINIMAL_STACK_SIZE;
+  obj_add("IDLE", NULL, configMINIMAL_STACK_SIZE, sizeof(s_stack) + sizeof(s_tcb));
+}
+
+#if configUSE_TIMERS
+void vApplicationGetTimerTaskMemory(StaticTask_t **tcb, StackType_t **stack, uint32_t *words){
+  static StaticTask_t s_tcb;
+  static StackType_t s_stack[configTIMER_TASK_STACK_DEPTH];
+  *tcb = &s_tcb;
+  *stack = s_stack;
+  *words = configTIMER_TASK_STACK_DEPTH;
+  obj_add(configTIMER_SERVICE_TASK_NAME, NULL, configTIMER_TASK_STACK_DEPTH, sizeof(s_stack) + sizeof(s_tcb));
+}
+#endif
+
+#if configUSE_MALLOC_FAILED_HOOK
+// Nothing of ours allocates; this is the SDK or a regression
+void vApplicationMallocFailedHook(void){
+  LOGE("rtos: heap allocation failed");
+  configASSERT(0);
+}
+#endif
+
+#if PICO_ON_DEVICE
+extern char __bss_end__[];
+#ifndef PICO_STACK_SIZE
+#define PICO_STACK_SIZE 0x800u
+#endif
+#ifndef PICO_CORE1_STACK_SIZE
+#define PICO_CORE1_STACK_SIZE 0x800u
+#endif
+#endif
+
+void app_ram_report(void){
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < s_n_obj; i++){
+    app_obj_t *o = &s_obj[i];
+    total += o->bytes;
+    if (!o->stack_words){
+      LOGI("ram: %-10s %6lu B", o->name, (unsigned long)o->bytes);
+      continue;
+    }
+    // idle / timer: only named until the scheduler has created them
+    if (!o->task && xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED)
+      o->task = xTaskGetHandle(o->name);
+    if (o->task){
+      uint32_t free_w = (uint32_t)uxTaskGetStackHighWaterMark(o->task);
+      LOGI("ram: %-10s %6lu B, stack %lu/%lu words used (hwm)", o->name, (unsigned long)o->bytes,
+           (unsigned long)(o->stack_words - free_w), (unsigned long)o->stack_words);
+    } else {
+      LOGI("ram: %-10s %6lu B, stack %lu words", o->name, (unsigned long)o->bytes,
+           (unsigned long)o->stack_words);
+    }
+  }
+  LOGI("ram: %u RTOS objects, %lu B", s_n_obj, (unsigned long)total);
+
+#if PICO_ON_DEVICE
+  size_t heap_free = xPortGetFreeHeapSize();
+  LOGI("ram: FreeRTOS heap %lu of %lu B free (min ever %lu)", (unsigned long)heap_free,
+       (unsigned long)configTOTAL_HEAP_SIZE, (unsigned long)xPortGetMinimumEverFreeHeapSize());
+  // data + bss (RTOS objects and the FreeRTOS heap included), newlib's heap,
+  // and the two core stacks in the scratch banks
+  uint32_t statics = (uint32_t)((uintptr_t)__bss_end__ - SRAM_BASE);
+  uint32_t arena = (uint32_t)mallinfo().arena;
+  uint32_t stacks = PICO_STACK_SIZE + PICO_CORE1_STACK_SIZE;
+  uint32_t used = statics + arena + stacks;
+  LOGI("ram: data+bss %lu B + malloc %lu B + core stacks %lu B = %lu of %lu B (%lu%%)",
+       (unsigned long)statics, (unsigned long)arena, (unsigned long)stacks,
+       (unsigned long)used, (unsigned long)APP_RAM_BUDGET,
+       (unsigned long)(used * 100u / APP_RAM_BUDGET));
+#else
+  LOGI("ram: heap and static totals are on-target only");
+#endif
+}
@@ -0,0 +1,34 @@
+// src/env_sensors.c
+#include "env_sensors.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <math.h>
+#if PICO_ON_DEVICE
+#include "hardware/adc.h"
+#include "pico_wspr_horus.h"
+#endif
+
+void env_sensors_read(int16_t *temp_c, uint16_t *volt_mv){
+#if PICO_ON_DEVICE
+  static bool init;
+  // One mux, two users (wsched, the Horus keyer): select + read as a unit
+  taskENTER_CRITICAL();
+  if (!init){
+    adc_init();
+    adc_gpio_init(PIN_VSYS_ADC);
+    adc_set_temp_sensor_enabled(true);
+    init = true;
+  }
+  adc_select_input(PIN_VSYS_ADC - 26);
+  uint32_t vsys = adc_read();
+  adc_select_input(4);
+  uint32_t raw_t = adc_read();
+  taskEXIT_CRITICAL();
+  float v_t = raw_t * 3.3f / 4096.0f;
+  *volt_mv = (uint16_t)(vsys * 3u * 3300u / 4096u);
+  *temp_c = (int16_t)lroundf(27.0f - (v_t - 0.706f) / 0.001721f);
+#else
+  *temp_c = 20;
+  *volt_mv = 4100;
+#endif
+}
@@ -4,14 +4,19 @@
 #include "task.h"
 #include "logging.h"
 #include "msg_bus.h"
+#include "nav_predict.h"
+#include "radio_arbiter.h"
+#include "tasks/task_wsched.h"
+#include "tasks/task_hsched.h"
+#include "app_rtos.h"
 //#include "boards/pico_wspr_horus.h"
 
 extern void task_console_start(void);
 extern void task_gps_start(void);
 extern void radio_hw_init(void);
 //extern void task_radio_start(void);
-//extern void task_wspr_start(void);
-//extern void task_horus_start(void);
+extern void task_wspr_start(void);
+extern void task_horus_start(void);
 
 int main() {
   sleep_ms(10000);
@@ -19,17 +24,19 @@ int main() {
   LOGI("minimal-balloon-tx boot");
 
   msg_bus_init();
+  nav_predict_init();
 
   radio_hw_init();
   task_console_start();
   task_radio_arbiter_start();
   task_gps_start();
   task_wsched_start();   // start scheduler that waits for 10-min marks
-//  task_wspr_start();
+  task_wspr_start();     // keyer + first frame build, ahead of any slot
+  task_hsched_start();   // Horus on the odd minutes WSPR leaves free
+  task_horus_start();
 //  task_radio_start();
-//  task_wspr_start();
-//  task_horus_start();
 
+  app_ram_report();      // everything is allocated by now
   vTaskStartScheduler();
   while (1) { }
 }
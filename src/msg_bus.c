@@ -1,12 +1,107 @@
 #include "msg_bus.h"
+#include "app_rtos.h"
+#include <string.h>
+#include <stdatomic.h>
 
-QueueHandle_t q_gps_fixes;
 QueueHandle_t q_tx_jobs;
 EventGroupHandle_t eg_system;
 
+// ---- latest-fix mailbox ----
+static gps_fix_t s_fix;
+static _Atomic uint32_t s_fix_seq = 0;   // odd while the writer is inside
+static msg_chan_stats_t s_fix_st;
+
+// ---- TX job pool ----
+static tx_job_t s_jobs[TX_JOB_POOL];
+static QueueHandle_t q_job_free;         // tx_job_t* free list
+static msg_chan_stats_t s_tx_st;
+
 void msg_bus_init(void) {
-  // Create only what your console task might touch (or nothing yet)
-  eg_system = xEventGroupCreate();
-  q_gps_fixes = xQueueCreate(4, sizeof(int)); // placeholder type
-  q_tx_jobs   = xQueueCreate(4, sizeof(int));
-}
\ No newline at end of file
+  static StaticEventGroup_t eg_buf;
+  static StaticQueue_t q_tx_buf, q_free_buf;
+  static uint8_t q_tx_store[APP_TX_JOB_QUEUE_LEN * sizeof(tx_job_t *)];
+  static uint8_t q_free_store[TX_JOB_POOL * sizeof(tx_job_t *)];
+  eg_system  = xEventGroupCreateStatic(&eg_buf);
+  q_tx_jobs  = xQueueCreateStatic(APP_TX_JOB_QUEUE_LEN, sizeof(tx_job_t *), q_tx_store, &q_tx_buf);
+  q_job_free = xQueueCreateStatic(TX_JOB_POOL, sizeof(tx_job_t *), q_free_store, &q_free_buf);
+  app_rtos_register("eg_system", sizeof(eg_buf));
+  app_rtos_register("q_tx_jobs", sizeof(q_tx_buf) + sizeof(q_tx_store));
+  app_rtos_register("q_jobfree", sizeof(q_free_buf) + sizeof(q_free_store));
+  app_rtos_register("job_pool", sizeof(s_jobs));
+  for (int i = 0; i < TX_JOB_POOL; i++) {
+    tx_job_t *j = &s_jobs[i];
+    xQueueSend(q_job_free, &j, 0);
+  }
+}
+
+// The copy is a few words and can't be preempted: a higher-priority reader
+// spinning on an odd seq would otherwise starve the writer on a single core
+void msg_bus_publish_fix(const gps_fix_t *fix) {
+  taskENTER_CRITICAL();
+  atomic_fetch_add(&s_fix_seq, 1);
+  s_fix = *fix;
+  atomic_fetch_add(&s_fix_seq, 1);
+  s_fix_st.publishes++;
+  taskEXIT_CRITICAL();
+}
+
+bool msg_bus_latest_fix(gps_fix_t *out, uint32_t *seq) {
+  uint32_t s0, s1;
+  do {
+    s0 = atomic_load(&s_fix_seq);
+    *out = s_fix;
+    s1 = atomic_load(&s_fix_seq);
+  } while ((s0 & 1u) || s0 != s1);
+
+  if (s0 == 0) return false;             // nothing published yet
+  if (seq) {
+    // each publish moves seq by 2
+    if (*seq) {
+      uint32_t lag = (s0 - *seq) / 2u;
+      if (lag > 0) lag--;                // the one we just read isn't "missed"
+      taskENTER_CRITICAL();              // readers on several tasks
+      if (lag > s_fix_st.max_lag) s_fix_st.max_lag = lag;
+      taskEXIT_CRITICAL();
+    }
+    *seq = s0;
+  }
+  return true;
+}
+
+tx_job_t *msg_bus_tx_job_alloc(void) {
+  tx_job_t *j = NULL;
+  if (!q_job_free || xQueueReceive(q_job_free, &j, 0) != pdPASS) {
+    s_tx_st.drops++;
+    return NULL;
+  }
+  memset(j, 0, sizeof(*j));
+  return j;
+}
+
+void msg_bus_tx_job_free(tx_job_t *job) {
+  if (job) xQueueSend(q_job_free, &job, 0);
+}
+
+bool msg_bus_tx_job_post(tx_job_t *job) {
+  if (!job) return false;
+  if (xQueueSend(q_tx_jobs, &job, 0) != pdPASS) {
+    s_tx_st.drops++;
+    msg_bus_tx_job_free(job);
+    return false;
+  }
+  s_tx_st.publishes++;
+  return true;
+}
+
+tx_job_t *msg_bus_tx_job_receive(TickType_t wait) {
+  tx_job_t *j = NULL;
+  UBaseType_t depth = uxQueueMessagesWaiting(q_tx_jobs);
+  if (depth > s_tx_st.max_lag) s_tx_st.max_lag = depth;
+  if (xQueueReceive(q_tx_jobs, &j, wait) != pdPASS) return NULL;
+  return j;
+}
+
+void msg_bus_get_stats(msg_chan_stats_t *fix, msg_chan_stats_t *tx) {
+  if (fix) *fix = s_fix_st;
+  if (tx)  *tx  = s_tx_st;
+}
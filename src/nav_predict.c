@@ -0,0 +1,192 @@
+// src/nav_predict.c
+#include "nav_predict.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdatomic.h>
+#include <string.h>
+
+#define NAV_RATE_MIN_S     30      // shortest baseline we measure a rate over
+#define NAV_RATE_TAU_S     600     // smoothing: a 10 min baseline counts ~half
+#define NAV_STALE_S        21600   // after 6 h without a fix, start over
+#define NAV_VEL_ERR0_CMS   3000    // no rate yet: assume up to 30 m/s of wind
+#define NAV_ACCEL_MMS2     5       // wind shear allowance, mm/s^2
+#define NAV_UERE_CM        500     // per unit of HDOP
+#define NAV_ERR_MIN_M      5
+
+// e7 degrees of latitude -> mm (1e-7 deg = 11.1195 mm)
+#define E7_TO_MM_NUM 111195
+#define E7_TO_MM_DEN 10000
+
+typedef struct {
+  bool     valid;
+  uint32_t t0;                 // UTC of the last fix
+  int32_t  lat_e7, lon_e7, alt_cm;
+  int32_t  lat_r, lon_r, alt_r; // rates, Q8 (e7/s * 256, cm/s * 256)
+  bool     have_rate;
+  uint32_t vel_err_cms;
+  uint32_t pos_err_m;          // from HDOP at the last fix
+  // rate baseline anchor
+  uint32_t ta;
+  int32_t  lat_a, lon_a, alt_a;
+} nav_state_t;
+
+static nav_state_t s_st;
+static _Atomic uint32_t s_seq = 0;   // seqlock (odd = writing)
+static nav_predict_stats_t s_stats;
+
+static void state_read(nav_state_t *out){
+  uint32_t s0, s1;
+  do {
+    s0 = atomic_load(&s_seq);
+    *out = s_st;
+    s1 = atomic_load(&s_seq);
+  } while ((s0 & 1u) || s0 != s1);
+}
+
+// cos(lat) in Q15, 10-degree table with linear interpolation (< 0.4% error)
+static int32_t cos_q15(int32_t lat_e7){
+  static const uint16_t k_cos[10] = {
+    32768, 32270, 30792, 28378, 25102, 21063, 16384, 11207, 5690, 0 };
+  uint32_t a = (uint32_t)(lat_e7 < 0 ? -lat_e7 : lat_e7);
+  if (a >= 900000000u) return 0;
+  uint32_t i = a / 100000000u;                // 10 deg steps
+  uint32_t f = (a % 100000000u) / 3052u;      // 0..32767
+  int32_t c0 = k_cos[i], c1 = k_cos[i + 1];
+  return c0 + (int32_t)(((int64_t)(c1 - c0) * f) >> 15);
+}
+
+// Longitude into [-180, 180) deg, and a difference of two taken the short way
+// round, so a date-line crossing is a small step rather than ~360 deg
+static int32_t lon_wrap_e7(int64_t lon){
+  while (lon >= 1800000000) lon -= 3600000000LL;
+  while (lon < -1800000000) lon += 3600000000LL;
+  return (int32_t)lon;
+}
+static int64_t lon_diff_e7(int32_t a, int32_t b){
+  return lon_wrap_e7((int64_t)a - b);
+}
+
+static int64_t lat_e7_to_mm(int64_t d){ return d * E7_TO_MM_NUM / E7_TO_MM_DEN; }
+static int64_t lon_e7_to_mm(int64_t d, int32_t lat_e7){
+  return (lat_e7_to_mm(d) * cos_q15(lat_e7)) >> 15;
+}
+
+static uint64_t iabs64(int64_t v){ return (uint64_t)(v < 0 ? -v : v); }
+
+// |(a, b)| without a sqrt: max + 3/8 min, within ~7%
+static uint64_t hypot_approx(int64_t a, int64_t b){
+  uint64_t x = iabs64(a), y = iabs64(b);
+  if (x < y) { uint64_t t = x; x = y; y = t; }
+  return x + (3u * y) / 8u;
+}
+
+// Error bound dt seconds after the last fix, metres
+static uint32_t err_at(const nav_state_t *s, uint32_t dt){
+  uint64_t mm = (uint64_t)s->vel_err_cms * 10u * dt
+              + (uint64_t)NAV_ACCEL_MMS2 * dt * dt / 2u;
+  uint64_t m = s->pos_err_m + mm / 1000u;
+  return m > 0xFFFFFFF0u ? 0xFFFFFFF0u : (uint32_t)m;
+}
+
+void nav_predict_init(void){
+  atomic_fetch_add(&s_seq, 1);
+  memset(&s_st, 0, sizeof(s_st));
+  atomic_fetch_add(&s_seq, 1);
+  memset(&s_stats, 0, sizeof(s_stats));
+}
+
+void nav_predict_update(const gps_fix_t *fix){
+  if (!fix || !fix->fix_valid || !fix->unix_time) return;
+
+  nav_state_t n = s_st;    // single writer: no need for state_read here
+  uint32_t t = fix->unix_time;
+
+  if (!n.valid || t < n.t0 || t - n.t0 > NAV_STALE_S){
+    memset(&n, 0, sizeof(n));
+    n.valid = true;
+    n.vel_err_cms = NAV_VEL_ERR0_CMS;
+    n.ta = t; n.lat_a = fix->lat_e7; n.lon_a = lon_wrap_e7(fix->lon_e7); n.alt_a = fix->alt_cm;
+  } else if (t - n.ta >= NAV_RATE_MIN_S){
+    // Rate over the baseline since the anchor
+    int32_t dt = (int32_t)(t - n.ta);
+    int32_t rl = (int32_t)((((int64_t)fix->lat_e7 - n.lat_a) * 256) / dt);
+    int32_t ro = (int32_t)((lon_diff_e7(fix->lon_e7, n.lon_a) * 256) / dt);
+    int32_t ra = (int32_t)((((int64_t)fix->alt_cm - n.alt_a) * 256) / dt);
+
+    if (n.have_rate){
+      // How far off the old rate was over this baseline -> rate uncertainty
+      int64_t en = lat_e7_to_mm((int64_t)(rl - n.lat_r)) / 256;           // mm/s
+      int64_t ee = lon_e7_to_mm((int64_t)(ro - n.lon_r), fix->lat_e7) / 256;
+      uint32_t e_cms = (uint32_t)(hypot_approx(en, ee) / 10u);
+      n.vel_err_cms = (n.vel_err_cms * 3u + e_cms + 3u) / 4u;
+
+      // Longer baselines are more trustworthy: w = dt / (dt + tau), Q8
+      int32_t w = (int32_t)((dt << 8) / (dt + NAV_RATE_TAU_S));
+      n.lat_r += (int32_t)(((int64_t)(rl - n.lat_r) * w) >> 8);
+      n.lon_r += (int32_t)(((int64_t)(ro - n.lon_r) * w) >> 8);
+      n.alt_r += (int32_t)(((int64_t)(ra - n.alt_r) * w) >> 8);
+    } else {
+      n.lat_r = rl; n.lon_r = ro; n.alt_r = ra;
+      n.have_rate = true;
+      // first measurement: uncertainty is mostly GPS noise over the baseline
+      n.vel_err_cms = (uint32_t)(2u * NAV_UERE_CM / (uint32_t)dt) + 50u;
+    }
+    n.ta = t; n.lat_a = fix->lat_e7; n.lon_a = lon_wrap_e7(fix->lon_e7); n.alt_a = fix->alt_cm;
+    s_stats.rate_updates++;
+  }
+
+  n.t0 = t;
+  n.lat_e7 = fix->lat_e7;
+  n.lon_e7 = lon_wrap_e7(fix->lon_e7);
+  n.alt_cm = fix->alt_cm;
+  uint32_t pe = (uint32_t)fix->hdop_x100 * NAV_UERE_CM / 10000u;
+  n.pos_err_m = pe < NAV_ERR_MIN_M ? NAV_ERR_MIN_M : pe;
+
+  // Not preemptible: a higher-priority reader spinning on an odd seq would
+  // starve this (the GPS task) on a single core
+  taskENTER_CRITICAL();
+  atomic_fetch_add(&s_seq, 1);
+  s_st = n;
+  atomic_fetch_add(&s_seq, 1);
+  taskEXIT_CRITICAL();
+
+  s_stats.fixes++;
+  s_stats.last_fix_utc = t;
+}
+
+bool nav_predict_at(uint32_t utc, nav_pos_t *out){
+  nav_state_t s;
+  state_read(&s);
+  if (!s.valid || !out) return false;
+
+  // Never extrapolate backwards past the last fix
+  uint32_t dt = utc > s.t0 ? utc - s.t0 : 0;
+  int64_t lat = s.lat_e7 + (((int64_t)s.lat_r * dt) >> 8);
+  int64_t lon = s.lon_e7 + (((int64_t)s.lon_r * dt) >> 8);
+  if (lat >  900000000) lat =  900000000;
+  if (lat < -900000000) lat = -900000000;
+  out->lat_e7 = (int32_t)lat;
+  out->lon_e7 = lon_wrap_e7(lon);                   // across the date line
+  out->alt_cm = s.alt_cm + (int32_t)(((int64_t)s.alt_r * dt) >> 8);
+  out->err_m  = err_at(&s, dt);
+  out->age_s  = dt;
+  return true;
+}
+
+uint32_t nav_predict_err_m(uint32_t utc){
+  nav_state_t s;
+  state_read(&s);
+  if (!s.valid) return UINT32_MAX;
+  return err_at(&s, utc > s.t0 ? utc - s.t0 : 0);
+}
+
+void nav_predict_get_stats(nav_predict_stats_t *out){
+  if (!out) return;
+  nav_state_t s;
+  state_read(&s);
+  *out = s_stats;
+  out->vn_cms = (int32_t)(lat_e7_to_mm(s.lat_r) / 2560);
+  out->ve_cms = (int32_t)(lon_e7_to_mm(s.lon_r, s.lat_e7) / 2560);
+  out->vu_cms = s.alt_r / 256;
+  out->vel_err_cms = s.vel_err_cms;
+}
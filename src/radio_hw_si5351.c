@@ -0,0 +1,57 @@
+#include "radio_hw.h"
+#include "si5351.h"
+#include "logging.h"
+
+static si5351_tones_t s_tones[RADIO_HW_OUTPUTS];
+static uint8_t s_sel = 1u;        // selected outputs
+static uint8_t s_planned;         // outputs with a tone table
+
+// Output n is CLKn. Frames normally bypass set_freq entirely via the DMA
+// sequencer (symbol_play_t.dma); this path is for single tones and the
+// alarm-driven fallback. set_freq stays on CLK0.
+
+static uint8_t pll_of(uint8_t out){ return out ? 1 : 0; }
+
+void radio_hw_init(void){
+  si5351_init();
+}
+
+void radio_hw_select_outputs(uint8_t mask){
+  s_sel = mask & ((1u << RADIO_HW_OUTPUTS) - 1u);
+  s_planned = 0;
+}
+
+void radio_hw_enable(bool on){
+  for (uint8_t ch = 0; ch < RADIO_HW_OUTPUTS; ch++)
+    if (s_sel & (1u << ch)) si5351_enable(ch, on);
+  LOGI("[RADIO] %s 0x%x", on ? "EN" : "DIS", s_sel);
+}
+
+void radio_hw_set_freq_hz(uint32_t hz){
+  si5351_set_freq(0, hz);
+}
+
+// Precompute the table and put tone 0 out, so any band change (multisynth
+// write + PLL reset) happens here rather than in the IRQ
+bool radio_hw_set_tones(uint8_t out, uint32_t base_hz, uint32_t step_uhz, uint8_t n){
+  if (out >= RADIO_HW_OUTPUTS || !(s_sel & (1u << out))) return false;
+  for (uint8_t o = 0; o < RADIO_HW_OUTPUTS; o++)
+    if (o != out && (s_planned & (1u << o)) && pll_of(o) == pll_of(out)) return false;
+  s_planned &= (uint8_t)~(1u << out);
+  if (!si5351_tones_init(&s_tones[out], out, base_hz, step_uhz, n) ||
+      !si5351_tones_select(&s_tones[out], 0)) return false;
+  s_planned |= (uint8_t)(1u << out);
+  return true;
+}
+
+// Symbol player's timer IRQ: only the PLL bytes that changed, usually 1-2
+// per output (~75 us at 400 kHz), no logging
+void radio_hw_set_tone(uint8_t i){
+  for (uint8_t o = 0; o < RADIO_HW_OUTPUTS; o++)
+    if (s_planned & (1u << o)) si5351_tones_select(&s_tones[o], i);
+}
+
+void radio_hw_stop_all(void){
+  for (uint8_t ch = 0; ch < 3; ch++) si5351_enable(ch, false);
+  LOGI("[RADIO] stop_all");
+}
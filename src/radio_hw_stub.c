@@ -3,19 +3,40 @@
 
 static bool s_on = false;
 static uint32_t s_freq = 0;
+static uint32_t s_base_hz, s_step_uhz;
+static uint8_t s_sel = 1u;
 
 void radio_hw_init(void){
   LOGI("[RADIO] init (stub)");
 }
 
+void radio_hw_select_outputs(uint8_t mask){
+  s_sel = mask;
+}
+
 void radio_hw_enable(bool on){
   s_on = on;
-  LOGI("[RADIO] %s", on ? "EN" : "DIS");
+  LOGI("[RADIO] %s 0x%x", on ? "EN" : "DIS", s_sel);
 }
 
+// IRQ context (symbol player): record only
 void radio_hw_set_freq_hz(uint32_t hz){
   s_freq = hz;
-  LOGI("[RADIO] f=%u Hz", hz);
+}
+
+// Records the lowest-numbered output's plan only
+bool radio_hw_set_tones(uint8_t out, uint32_t base_hz, uint32_t step_uhz, uint8_t n){
+  (void)n;
+  if (out >= RADIO_HW_OUTPUTS || !(s_sel & (1u << out))) return false;
+  if (s_sel & ((1u << out) - 1u)) return true;
+  s_base_hz = base_hz;
+  s_step_uhz = step_uhz;
+  return true;
+}
+
+// IRQ context (symbol player): record only, nearest Hz
+void radio_hw_set_tone(uint8_t i){
+  s_freq = s_base_hz + (uint32_t)(((uint64_t)i * s_step_uhz + 500000u) / 1000000u);
 }
 
 void radio_hw_stop_all(void){
@@ -0,0 +1,205 @@
+// src/symbol_player.c
+#include "symbol_player.h"
+#include "radio_hw.h"
+#include "pico/time.h"
+#include <stdatomic.h>
+#include <string.h>
+#if RADIO_HW_SI5351
+#include "si5351.h"
+#endif
+
+static symbol_play_t s_p;
+static uint32_t s_k;                 // next edge to play, counted from the chain's start
+static uint32_t s_k0;                // edge of the current frame's symbol 0
+static symbol_play_t s_next;         // queued frame; symbols and n_symbols are what's used
+static _Atomic bool s_has_next = false;
+static _Atomic bool s_busy = false;
+static _Atomic bool s_abort = false;
+static bool s_dma;                   // current frame is on the DMA sequencer
+static uint64_t s_err_sum;
+static uint32_t s_err_max;
+static symbol_player_stats_t s_st;
+
+// Ideal time of edge k, boot us. 64-bit: k * num reaches ~1e12 for WSPR.
+// Queued frames continue the same schedule, so a chain doesn't drift either.
+static uint64_t edge_us(uint32_t k){
+  return s_p.start.us + ((uint64_t)k * s_p.period_num) / s_p.period_den;
+}
+
+static void frame_stats(void){
+  uint32_t n = s_k - s_k0;
+  s_st.frames++;
+  if (n) {
+    s_st.last_err_max_us = s_err_max;
+    s_st.last_err_avg_us = (uint32_t)(s_err_sum / n);
+  }
+}
+
+static void notify_owner(TaskHandle_t t){
+  if (t){
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(t, &woken);
+    portYIELD_FROM_ISR(woken);
+  }
+}
+
+static void frame_done(void){
+  frame_stats();
+  TaskHandle_t t = s_p.notify;
+  atomic_store(&s_has_next, false);
+  atomic_store(&s_busy, false);
+  notify_owner(t);
+}
+
+static boot_us_t arm_start(boot_us_t start){
+  uint64_t early = time_us_64() + SYMBOL_ARM_MARGIN_US;
+  return start.us < early ? (boot_us_t){ early } : start;
+}
+
+static void note_start(boot_us_t booked, boot_us_t start){
+  s_st.last_start_late_us = (uint32_t)(start.us - booked.us);
+  if (s_st.last_start_late_us) s_st.late_starts++;
+}
+
+boot_us_t symbol_player_arm_start(boot_us_t start){
+  boot_us_t s = arm_start(start);
+  note_start(start, s);
+  return s;
+}
+
+// Timer IRQ: one call per symbol edge plus one at the end of the frame
+static int64_t symbol_alarm(alarm_id_t id, void *user){
+  (void)id; (void)user;
+  uint64_t now = time_us_64();      // first: the error is what the radio sees
+  uint32_t k = s_k;
+  uint64_t ideal = edge_us(k);
+  uint32_t err = now > ideal ? (uint32_t)(now - ideal) : 0;
+  uint32_t i = k - s_k0;
+
+  // Back to back: the last frame's end edge is the queued frame's symbol 0.
+  // Take it over before waking the owner, who may refill s_next at once.
+  if (i >= s_p.n_symbols && !atomic_load(&s_abort) && atomic_exchange(&s_has_next, false)){
+    frame_stats();
+    s_p.symbols = s_next.symbols;
+    s_p.n_symbols = s_next.n_symbols;
+    s_k0 = k;
+    i = 0;
+    s_err_sum = 0;
+    s_err_max = 0;
+    notify_owner(s_p.notify);
+  }
+
+  if (i >= s_p.n_symbols || atomic_load(&s_abort)){
+    if (i < s_p.n_symbols) s_st.aborted++;
+    frame_done();
+    return 0;
+  }
+
+  radio_hw_set_tone(symbol_play_sym(&s_p, (uint16_t)i));
+
+  s_st.symbols++;
+  s_err_sum += err;
+  if (err > s_err_max) s_err_max = err;
+  if (err > s_st.err_max_us) s_st.err_max_us = err;
+  if (err > SYMBOL_LATE_US) s_st.late_edges++;
+  timing_hist_add(&s_st.edge_err, err);
+
+  s_k = k + 1;
+  // negative: re-arm relative to this alarm's target, not to now, so IRQ
+  // latency never carries into the next edge
+  return -(int64_t)(edge_us(k + 1) - ideal);
+}
+
+bool symbol_player_start(const symbol_play_t *p){
+  if (!p || !p->symbols || !p->n_symbols || !p->n_tones || !p->period_num || !p->period_den)
+    return false;
+  for (uint16_t i = 0; i < p->n_symbols; i++)
+    if (symbol_play_sym(p, i) >= p->n_tones) return false;
+
+#if RADIO_HW_SI5351
+  if (p->dma){
+    if (symbol_player_busy() || !si5351_seq_play(p)) return false;
+    s_dma = true;
+    s_st.last_err_max_us = 0;
+    s_st.last_err_avg_us = 0;
+    s_st.frames++;
+    s_st.symbols += p->n_symbols;
+    return true;
+  }
+#endif
+
+  bool idle = false;
+  if (!atomic_compare_exchange_strong(&s_busy, &idle, true)) return false;
+  s_dma = false;
+  if (!radio_hw_set_tones(p->out, p->base_hz, p->step_uhz, p->n_tones) ||
+      (p->base2_hz && !radio_hw_set_tones(p->out2, p->base2_hz, p->step_uhz, p->n_tones))){
+    atomic_store(&s_busy, false);
+    return false;
+  }
+
+  s_p = *p;
+  s_k = 0;
+  s_k0 = 0;
+  atomic_store(&s_has_next, false);
+  s_err_sum = 0;
+  s_err_max = 0;
+  atomic_store(&s_abort, false);
+  // Never fire_if_past: that runs symbol_alarm right here, in task context.
+  // If the edge slips by while arming, move it again.
+  alarm_id_t id;
+  do s_p.start = arm_start(p->start);
+  while ((id = add_alarm_at(from_us_since_boot(s_p.start.us), symbol_alarm, NULL, false)) == 0);
+  if (id < 0){
+    atomic_store(&s_busy, false);
+    return false;
+  }
+  note_start(p->start, s_p.start);
+  return true;
+}
+
+bool symbol_player_queue(const symbol_play_t *next){
+  if (!next || !next->symbols || !next->n_symbols || atomic_load(&s_has_next)) return false;
+  if (!atomic_load(&s_busy) || s_dma) return false;
+  // The tone plan and timing carry over; only the symbols change
+  if (next->n_tones != s_p.n_tones || next->base_hz != s_p.base_hz ||
+      next->step_uhz != s_p.step_uhz || next->out != s_p.out || next->base2_hz != s_p.base2_hz ||
+      next->out2 != s_p.out2 || next->period_num != s_p.period_num || next->period_den != s_p.period_den)
+    return false;
+  for (uint16_t i = 0; i < next->n_symbols; i++)
+    if (symbol_play_sym(next, i) >= next->n_tones) return false;
+
+  s_next = *next;
+  atomic_store(&s_has_next, true);
+  // The frame may have ended while we were checking: take it back if the
+  // IRQ hasn't
+  if (!atomic_load(&s_busy) && atomic_exchange(&s_has_next, false)) return false;
+  return true;
+}
+
+void symbol_player_abort(void){
+#if RADIO_HW_SI5351
+  if (s_dma){
+    if (si5351_seq_busy()) { s_st.aborted++; si5351_seq_abort(); }
+    return;
+  }
+#endif
+  if (atomic_load(&s_busy)) atomic_store(&s_abort, true);
+}
+
+bool symbol_player_busy(void){
+#if RADIO_HW_SI5351
+  if (s_dma) return si5351_seq_busy();
+#endif
+  return atomic_load(&s_busy);
+}
+
+void symbol_player_get_stats(symbol_player_stats_t *out){
+  if (out) *out = s_st;
+}
+
+// The IRQ is the writer: keep it out while the stats are cleared
+void symbol_player_reset_stats(void){
+  taskENTER_CRITICAL();
+  memset(&s_st, 0, sizeof(s_st));
+  taskEXIT_CRITICAL();
+}
@@ -3,16 +3,29 @@
 #include <stdlib.h> // atoi, strtoul, strtol, sscanf
 #include <stdint.h>
 #include "pico/stdlib.h"
+#if PICO_ON_DEVICE
+#include "hardware/clocks.h"
+#endif
 #include "FreeRTOS.h"
 #include "task.h"
 #include "logging.h"
+#include "msg_bus.h"
 #include "wspr_encoder.h"
+#include "horus_encoder.h"
 #include "timebase.h"
 #include "radio_arbiter.h"
+#include "gps_hw.h"
+#include "gps_nmea_replay.h"
+#include "nav_predict.h"
+#include "symbol_player.h"
+#include "radio_hw.h"
+#include "app_rtos.h"
+#include "tasks/task_gps.h"
+#include "tasks/task_horus.h"
 
-// Forward decls from task_wspr.c (or expose these in wspr_encoder.h; see note below)
-static void wspr_start(void *user){ /* set SI5351 base freq, symbol task kickoff */ }
-static void wspr_stop(void *user){  /* disable outputs, cleanup */ }
+// Forward decls from task_wspr.c: the real keyer callbacks, as wsched books them
+void wspr_start(void *user);
+void wspr_stop(void *user);
 
 void wspr_set_callsign(const char *cs);
 void wspr_set_grid(const char *grid);
@@ -24,6 +37,17 @@ uint32_t wspr_get_tone_step_uHz(void);
 
 // ---------------- console helpers ----------------
 
+// The single-band window commands edit band 0 of the plan
+static void console_wspr_band0_mask(uint32_t m)
+{
+  wspr_band_t b;
+  if (wspr_band_get(0, &b))
+  {
+    b.minute_mask = m;
+    wspr_band_set(0, &b);
+  }
+}
+
 static void console_handle_wspr(char *args)
 {
   // commands:
@@ -31,18 +55,25 @@ static void console_handle_wspr(char *args)
   //   wspr set call KI5YNG
   //   wspr set grid EM53
   //   wspr set pwr  13
-  //   wspr win 0,2,4,6,8        (even minutes only)
+  //   wspr set tid  Q0           (telemetry channel id)
+  //   wspr rot 1,t,3             (message rotation: 1/2/3 = type, t = telemetry)
+  //   wspr win 0,2,4,6,8        (even minutes only; band 0)
   //   wspr win mask 0x1F
-  //   wspr rf base 140956000     (Hz)
+  //   wspr rf base 140956000     (Hz, band 0)
+  //   wspr band                  (list the band plan)
+  //   wspr band 1 10140100 0x2A0 1   (index, Hz, minute mask, output)
   //   wspr rf step 1464844       (uHz)
+  //   wspr cache                 (prebuilt frame hits/misses)
+  //   wspr bench [n]             (golden-frame selftest + encoder timing)
 
   if (!strncmp(args, "test", 4))
   {
-    uint64_t start_ms = timebase_now_boot_ms() + 2000;
+    boot_us_t start = boot_add_us(timebase_boot_now(), 2000000);
     radio_req_t r = {
         .mode = MODE_WSPR,
-        .t_start_ms = start_ms,
-        .duration_ms = 5000, // short test burst
+        .t_start = start,
+        .duration_us = 5000000, // short test burst
+        .lead_us = WSPR_KEY_LEAD_US,
         .freq_hz = wspr_get_rf_base_hz(),
         .start_cb = wspr_start,
         .stop_cb = wspr_stop,
@@ -55,7 +86,46 @@ static void console_handle_wspr(char *args)
 
   if (!args || !*args)
   {
-    LOGI("wspr usage: show|set call <C>|set grid <G>|set pwr <dBm>|win <list>|win mask <hex>|rf base <Hz>|rf step <uHz>");
+    LOGI("wspr usage: show|set call <C>|set grid <G>|set pwr <dBm>|set tid <id>|rot [list]|win <list>|win mask <hex>|band [<i> <Hz> <mask> <out>]|rf base <Hz>|rf step <uHz>|cache|bench [n]");
+    return;
+  }
+
+  if (!strncmp(args, "bench", 5))
+  {
+    int n = atoi(args + 5);
+    if (n <= 0) n = 200;
+    int fails = wspr_selftest();
+    LOGI("wspr: selftest %s (%d failures)", fails ? "FAIL" : "PASS", fails);
+
+    wspr_cfg_t cfg = { "KI5YNG", "EM53", 13 };
+    static wspr_frame_t full;
+    uint8_t pk[WSPR_PACKED_BYTES];
+    boot_us_t t0 = timebase_boot_now();
+    for (int i = 0; i < n; i++) wspr_build_packed(&cfg, pk);
+    boot_us_t t1 = timebase_boot_now();
+    for (int i = 0; i < n; i++) wspr_build_frame(&cfg, &full);
+    boot_us_t t2 = timebase_boot_now();
+    uint32_t ns_pk = (uint32_t)(boot_diff_us(t1, t0) * 1000 / n);
+    uint32_t ns_full = (uint32_t)(boot_diff_us(t2, t1) * 1000 / n);
+#if PICO_ON_DEVICE
+    uint32_t mhz = clock_get_hz(clk_sys) / 1000000u;
+    LOGI("wspr: %d frames: packed %lu ns (%lu cycles), full %lu ns (%lu cycles)", n,
+         (unsigned long)ns_pk, (unsigned long)(ns_pk * mhz / 1000u),
+         (unsigned long)ns_full, (unsigned long)(ns_full * mhz / 1000u));
+#else
+    LOGI("wspr: %d frames: packed %lu ns, full %lu ns per frame (host)", n,
+         (unsigned long)ns_pk, (unsigned long)ns_full);
+#endif
+    return;
+  }
+
+  if (!strncmp(args, "cache", 5))
+  {
+    wspr_cache_stats_t c;
+    wspr_cache_get_stats(&c);
+    LOGI("wspr: cache hits=%lu misses=%lu rebuilds=%lu build_fail=%lu",
+         (unsigned long)c.hits, (unsigned long)c.misses,
+         (unsigned long)c.rebuilds, (unsigned long)c.build_fail);
     return;
   }
 
@@ -90,13 +160,66 @@ static void console_handle_wspr(char *args)
     return;
   }
 
+  if (!strncmp(args, "set tid ", 8))
+  {
+    wspr_set_telem_id(args + 8);
+    LOGI("wspr: telemetry id=%s", args + 8);
+    return;
+  }
+
+  if (!strncmp(args, "rot", 3))
+  {
+    wspr_msg_t seq[WSPR_ROT_MAX];
+    int n = 0;
+    for (char *p = args + 3; *p; p++)
+    {
+      if (*p == ' ' || *p == ',')
+        continue;
+      wspr_msg_t t = (*p == 't' || *p == 'T') ? WSPR_MSG_TELEM
+                   : (*p >= '1' && *p <= '3') ? (wspr_msg_t)(*p - '0') : (wspr_msg_t)0;
+      if (!t || n == WSPR_ROT_MAX)
+      {
+        LOGW("wspr: rotation is up to %d of 1,2,3,t", WSPR_ROT_MAX);
+        return;
+      }
+      seq[n++] = t;
+    }
+    if (n && !wspr_rotation_set(seq, n))
+      LOGW("wspr: rotation rejected");
+    n = wspr_rotation_get(seq, WSPR_ROT_MAX);
+    for (int i = 0; i < n; i++)
+      LOGI("wspr: rot[%d] %s", i, wspr_msg_name(seq[i]));
+    return;
+  }
+
+  if (!strncmp(args, "band", 4))
+  {
+    unsigned i, out;
+    unsigned long hz, mask;
+    if (sscanf(args + 4, "%u %lu %li %u", &i, &hz, (long *)&mask, &out) == 4)
+    {
+      wspr_band_t b = { (uint32_t)hz, (uint32_t)mask, (uint8_t)out };
+      if (i > 255 || out > 255 || !wspr_band_set((uint8_t)i, &b))
+        LOGW("wspr: band %u rejected (index <= %u, output < %d)", i, wspr_band_count(), RADIO_HW_OUTPUTS);
+    }
+    for (uint8_t k = 0; k < wspr_band_count(); k++)
+    {
+      wspr_band_t b;
+      if (wspr_band_get(k, &b))
+        LOGI("wspr: band %u %lu Hz mask=0x%08lx CLK%u", k, (unsigned long)b.base_hz,
+             (unsigned long)b.minute_mask, b.out);
+    }
+    LOGI("wspr: windows mask=0x%08lx", (unsigned long)wspr_minutes_mask_get());
+    return;
+  }
+
   if (!strncmp(args, "win mask ", 9))
   {
     unsigned int tmp = 0;
     if (sscanf(args + 9, "%i", (int *)&tmp) == 1)
     { // accepts 0x.. or decimal
-      wspr_minutes_mask_set((uint32_t)tmp);
-      LOGI("wspr: windows mask=0x%08lx", (unsigned long)tmp);
+      console_wspr_band0_mask((uint32_t)tmp);
+      LOGI("wspr: band 0 mask=0x%08lx", (unsigned long)tmp);
     }
     else
     {
@@ -126,8 +249,8 @@ static void console_handle_wspr(char *args)
       }
       m |= (1u << ((int)v / 2));
     }
-    wspr_minutes_mask_set(m);
-    LOGI("wspr: windows mask=0x%08lx", (unsigned long)m);
+    console_wspr_band0_mask(m);
+    LOGI("wspr: band 0 mask=0x%08lx", (unsigned long)m);
     return;
   }
 
@@ -150,6 +273,227 @@ static void console_handle_wspr(char *args)
   LOGW("wspr: unknown subcommand");
 }
 
+static void console_handle_horus(char *args)
+{
+  // commands:
+  //   horus show                 (config + keyer counters)
+  //   horus id 256               (payload ID)
+  //   horus baud 100             (100 or 300)
+  //   horus rf base 14097420     (Hz, tone 0)
+  //   horus rf step 270          (Hz)
+  //   horus bench [n]            (encoder selftest + v2 packet timing)
+  horus_cfg_t c;
+  horus_cfg_get(&c);
+
+  if (!strncmp(args, "show", 4))
+  {
+    horus_stats_t s;
+    horus_get_stats(&s);
+    LOGI("horus: id=%u %u baud, base=%lu Hz step=%lu Hz", c.payload_id, c.baud,
+         (unsigned long)c.base_hz, (unsigned long)c.step_hz);
+    LOGI("horus: windows=%lu packets=%lu underruns=%lu last=%lu (edge max %lu us) seq=%u",
+         (unsigned long)s.windows, (unsigned long)s.packets, (unsigned long)s.underruns,
+         (unsigned long)s.last_packets, (unsigned long)s.last_err_max_us, s.seq);
+    return;
+  }
+
+  if (!strncmp(args, "id ", 3) || !strncmp(args, "baud ", 5) || !strncmp(args, "rf ", 3))
+  {
+    if (!strncmp(args, "id ", 3)) c.payload_id = (uint16_t)strtoul(args + 3, NULL, 0);
+    else if (!strncmp(args, "baud ", 5)) c.baud = (uint16_t)strtoul(args + 5, NULL, 0);
+    else if (!strncmp(args + 3, "base ", 5)) c.base_hz = (uint32_t)strtoul(args + 8, NULL, 0);
+    else if (!strncmp(args + 3, "step ", 5)) c.step_hz = (uint32_t)strtoul(args + 8, NULL, 0);
+    if (horus_cfg_set(&c))
+      LOGI("horus: id=%u %u baud, base=%lu Hz step=%lu Hz (next window)", c.payload_id, c.baud,
+           (unsigned long)c.base_hz, (unsigned long)c.step_hz);
+    else
+      LOGW("horus: rejected (baud 100|300, base > 0, step 1..4294 Hz)");
+    return;
+  }
+
+  if (!strncmp(args, "bench", 5))
+  {
+    int n = atoi(args + 5);
+    if (n <= 0) n = 200;
+    int fails = horus_selftest();
+    LOGI("horus: selftest %s (%d failures)", fails ? "FAIL" : "PASS", fails);
+
+    telemetry_t t = {
+        .gps = {.fix_valid = 1, .lat_e7 = 353000000, .lon_e7 = -976000000, .alt_cm = 2500000,
+                .unix_time = 1780275845u, .sats = 9},
+        .vbatt_v = 3.7f, .temp_c = -30, .speed_kph = 40};
+    horus_v2_hdr_t h = {.payload_id = 256};
+    uint8_t sym[HORUS_V2_PACKED_BYTES];
+    boot_us_t t0 = timebase_boot_now();
+    for (int i = 0; i < n; i++)
+    {
+      h.seq = (uint16_t)i;
+      horus_build_v2(&t, &h, sym);
+    }
+    uint32_t ns = (uint32_t)(boot_diff_us(timebase_boot_now(), t0) * 1000 / n);
+#if PICO_ON_DEVICE
+    uint32_t mhz = clock_get_hz(clk_sys) / 1000000u;
+    LOGI("horus: %d packets: %lu us (%lu cycles) per packet", n,
+         (unsigned long)(ns / 1000u), (unsigned long)(ns * mhz / 1000u));
+#else
+    LOGI("horus: %d packets: %lu ns per packet (host)", n, (unsigned long)ns);
+#endif
+    return;
+  }
+
+  LOGI("horus usage: show|id <n>|baud <100|300>|rf base <Hz>|rf step <Hz>|bench [n]");
+}
+
+static void console_handle_gps(char *args)
+{
+  // commands:
+  //   gps stats
+  //   gps power
+  //   gps predict
+  //   gps replay [passes]       (parser corpus: correctness + throughput)
+  if (!strncmp(args, "stats", 5))
+  {
+    gps_rx_stats_t st;
+    gps_rx_get_stats(&st);
+    LOGI("gps: rx=%lu lines=%lu overruns=%lu dropped=%lu ring_hwm=%u",
+         (unsigned long)st.rx_bytes, (unsigned long)st.lines,
+         (unsigned long)st.overruns, (unsigned long)st.dropped,
+         (unsigned)st.ring_hwm);
+    nmea_stats_t ns;
+    gps_nmea_get_stats(&ns);
+    LOGI("gps: nmea ok=%lu rejected=%lu bad_cksum=%lu overlong=%lu",
+         (unsigned long)ns.sentences, (unsigned long)ns.rejected,
+         (unsigned long)ns.bad_checksum, (unsigned long)ns.overlong);
+    ubx_stats_t us;
+    gps_ubx_get_stats(&us);
+    LOGI("gps: ubx frames=%lu bad_cksum=%lu oversize=%lu",
+         (unsigned long)us.frames, (unsigned long)us.bad_checksum, (unsigned long)us.oversize);
+    LOGI("gps: pps edges=%lu, time %s", (unsigned long)gps_pps_edges(),
+         timebase_pps_locked() ? "PPS-locked" : (timebase_utc_valid() ? "UART-timed" : "invalid"));
+    timebase_status_t tb;
+    timebase_get_status(&tb);
+    LOGI("gps: clock %ld ppb (+/-%lu), err +/-%lu us, latch age %lu s, slewing %ld us, steps=%lu slews=%lu freq=%lu",
+         (long)tb.ppb, (unsigned long)tb.ppb_unc, (unsigned long)tb.err_us,
+         (unsigned long)tb.age_s, (long)tb.slewing_us, (unsigned long)tb.steps,
+         (unsigned long)tb.slews, (unsigned long)tb.freq_updates);
+    return;
+  }
+
+  if (!strncmp(args, "power", 5))
+  {
+    gps_pwr_stats_t ps;
+    gps_pwr_get_stats(&ps);
+    LOGI("gps: %s, lead=%lu s, last ttf=%lu ms, on %lu s this hour / %lu s last hour, cycles=%lu misses=%lu",
+         ps.on ? "ON" : "off", (unsigned long)ps.lead_s, (unsigned long)ps.last_ttf_ms,
+         (unsigned long)ps.on_s_this_hour, (unsigned long)ps.on_s_last_hour,
+         (unsigned long)ps.cycles, (unsigned long)ps.misses);
+    LOGI("gps: %lu windows served from the predictor", (unsigned long)ps.skips);
+    return;
+  }
+
+  if (!strncmp(args, "predict", 7))
+  {
+    nav_pos_t p;
+    nav_predict_stats_t st;
+    nav_predict_get_stats(&st);
+    if (!nav_predict_at(timebase_utc_now(), &p))
+    {
+      LOGI("gps: predictor has no fix yet");
+      return;
+    }
+    LOGI("gps: predict lat=%ld lon=%ld (e7) alt=%ld cm, age %lu s, +/-%lu m",
+         (long)p.lat_e7, (long)p.lon_e7, (long)p.alt_cm,
+         (unsigned long)p.age_s, (unsigned long)p.err_m);
+    LOGI("gps: rate n=%ld e=%ld u=%ld cm/s (+/-%lu), fixes=%lu rate updates=%lu",
+         (long)st.vn_cms, (long)st.ve_cms, (long)st.vu_cms, (unsigned long)st.vel_err_cms,
+         (unsigned long)st.fixes, (unsigned long)st.rate_updates);
+    return;
+  }
+
+  if (!strncmp(args, "replay", 6))
+  {
+    uint32_t passes = (uint32_t)strtoul(args + 6, NULL, 10);
+    if (passes == 0)
+      passes = 200;
+    nmea_replay_result_t r;
+    nmea_replay_run(passes, time_us_64, &r);
+    uint32_t ns_line = r.lines ? (uint32_t)(r.elapsed_us * 1000ULL / r.lines) : 0;
+    uint32_t lines_s = r.elapsed_us ? (uint32_t)(r.lines * 1000000ULL / r.elapsed_us) : 0;
+    LOGI("gps: replay %lu passes, %lu lines, %lu bytes in %lu us: %lu ns/line, %lu lines/s",
+         (unsigned long)r.passes, (unsigned long)r.lines, (unsigned long)r.bytes,
+         (unsigned long)r.elapsed_us, (unsigned long)ns_line, (unsigned long)lines_s);
+    LOGI("gps: replay checks %lu/%lu ok, counters %s (ok=%lu rejected=%lu bad_cksum=%lu overlong=%lu) -> %s",
+         (unsigned long)(r.checks - r.failures), (unsigned long)r.checks,
+         r.stats_ok ? "match" : "MISMATCH",
+         (unsigned long)r.stats.sentences, (unsigned long)r.stats.rejected,
+         (unsigned long)r.stats.bad_checksum, (unsigned long)r.stats.overlong,
+         (r.failures == 0 && r.stats_ok) ? "PASS" : "FAIL");
+    return;
+  }
+
+  LOGI("gps usage: stats|power|predict|replay [n]");
+}
+
+static void console_handle_bus(char *args)
+{
+  // commands:
+  //   bus stats
+  if (!strncmp(args, "stats", 5))
+  {
+    msg_chan_stats_t fix, tx;
+    msg_bus_get_stats(&fix, &tx);
+    LOGI("bus: fix publishes=%lu max_lag=%lu",
+         (unsigned long)fix.publishes, (unsigned long)fix.max_lag);
+    LOGI("bus: tx publishes=%lu drops=%lu max_depth=%lu",
+         (unsigned long)tx.publishes, (unsigned long)tx.drops, (unsigned long)tx.max_lag);
+    return;
+  }
+
+  LOGI("bus usage: stats");
+}
+
+static void log_hist(const char *name, const timing_hist_t *h)
+{
+  char buf[160];
+  timing_hist_format(h, buf, sizeof(buf));
+  LOGI("radio: %-5s %s", name, buf);
+}
+
+static void console_handle_radio(char *args)
+{
+  // commands:
+  //   radio stats      (dump timing telemetry, then reset it)
+  if (!strncmp(args, "stats", 5))
+  {
+    radio_arbiter_stats_t a;
+    symbol_player_stats_t p;
+    radio_arbiter_get_stats(&a);
+    symbol_player_get_stats(&p);
+    for (int m = 0; m < RADIO_MODES; m++)
+    {
+      const radio_mode_stats_t *s = &a.mode[m];
+      LOGI("radio: %-5s admitted=%lu rejected=%lu preempted=%lu cancelled=%lu missed=%lu windows=%lu",
+           m == MODE_WSPR ? "WSPR" : "Horus",
+           (unsigned long)s->admitted, (unsigned long)s->rejected, (unsigned long)s->preempted,
+           (unsigned long)s->cancelled, (unsigned long)s->missed, (unsigned long)s->windows);
+    }
+    LOGI("radio: missed late=%lu hw_lock=%lu, aborted on air=%lu, calendar %u (max %u)",
+         (unsigned long)a.miss[RADIO_MISS_LATE], (unsigned long)a.miss[RADIO_MISS_HW_LOCK],
+         (unsigned long)a.aborted, a.booked, a.booked_max);
+    log_hist("late", &a.late);
+    log_hist("cb", &a.cb);
+    LOGI("radio: keyer frames=%lu aborted=%lu late_starts=%lu symbols=%lu late_edges=%lu",
+         (unsigned long)p.frames, (unsigned long)p.aborted, (unsigned long)p.late_starts,
+         (unsigned long)p.symbols, (unsigned long)p.late_edges);
+    log_hist("edge", &p.edge_err);
+    radio_arbiter_reset_stats();
+    symbol_player_reset_stats();
+    return;
+  }
+
+  LOGI("radio usage: stats");
+}
+
 static void console_handle_line(char *line)
 {
   // Trim leading spaces
@@ -164,6 +508,37 @@ static void console_handle_line(char *line)
     return;
   }
 
+  if (!strncmp(line, "horus ", 6))
+  {
+    console_handle_horus(line + 6);
+    return;
+  }
+
+  if (!strncmp(line, "gps ", 4))
+  {
+    console_handle_gps(line + 4);
+    return;
+  }
+
+  if (!strncmp(line, "bus ", 4))
+  {
+    console_handle_bus(line + 4);
+    return;
+  }
+
+  if (!strncmp(line, "radio ", 6))
+  {
+    console_handle_radio(line + 6);
+    return;
+  }
+
+  // ram: per-task stack high-water marks, RTOS objects, heap, RAM budget
+  if (!strncmp(line, "ram", 3))
+  {
+    app_ram_report();
+    return;
+  }
+
   // Add other command namespaces here later...
   LOGI("unknown cmd: %s", line);
 }
@@ -206,11 +581,8 @@ static void console_thread(void *arg)
 
 void task_console_start(void)
 {
-  xTaskCreate(
-      console_thread,
-      "console",
-      1024, // stack words
-      NULL,
-      tskIDLE_PRIORITY + 1,
-      NULL);
+  static StackType_t stack[APP_STACK_CONSOLE];
+  static StaticTask_t tcb;
+  app_task_create(console_thread, "console", NULL, APP_PRIO_CONSOLE,
+                  stack, APP_STACK_CONSOLE, &tcb);
 }
\ No newline at end of file
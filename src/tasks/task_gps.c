@@ -1,27 +1,190 @@
 #include "FreeRTOS.h"
 #include "task.h"
+#include "event_groups.h"
 #include "logging.h"
 #include "gps_hw.h"
+#include "msg_bus.h"
+#include "timebase.h"
+#include "radio_arbiter.h"
+#include "wspr_encoder.h"
+#include "nav_predict.h"
+#include "tasks/task_gps.h"
+#include "app_rtos.h"
+
+// GPS power manager: keep the receiver off except for a short run before each
+// transmit window, long enough for a hot-start fix and a few PPS-bound latches.
+// The lead time tracks the measured hot-start time-to-fix.
+
+#define GPS_LEAD_MIN_S      15      // never wake later than this before a window
+#define GPS_LEAD_MAX_S      180
+#define GPS_LEAD_MARGIN_S   10      // added on top of the smoothed TTF
+#define GPS_MIN_OFF_S       45      // shorter gaps aren't worth a power cycle
+#define GPS_MAX_OFF_S       1800    // refresh at least this often, windows or not
+#define GPS_HOT_TIMEOUT_S   240     // give up on a fix and let the window go stale
+#define GPS_COLD_TIMEOUT_S  1200    // first fix after boot
+#define GPS_SETTLE_S        5       // keep running after the fix for PPS latches
+#define GPS_SKIP_ERR_M      2000    // predictor good enough: well inside a subsquare
+#define GPS_SKIP_TIME_US    100000  // holdover good enough: WSPR decoders take +/-1 s
 
 static bool started = false;
 
-static void gps_boot_task(void *arg){
+static bool     s_on = false;
+static uint64_t s_on_since_ms = 0;
+static uint64_t s_hour_start_ms = 0;
+static uint32_t s_on_ms_hour = 0;
+static gps_pwr_stats_t s_st = { .lead_s = 60 };
+static uint32_t s_ttf_avg_ms = 0;       // EWMA of hot-start TTF
+
+static void pwr_account(uint64_t now_ms){
+  if (s_on){
+    s_on_ms_hour += (uint32_t)(now_ms - s_on_since_ms);
+    s_on_since_ms = now_ms;
+  }
+  if (now_ms - s_hour_start_ms >= 3600000ULL){
+    s_st.on_s_last_hour = s_on_ms_hour / 1000u;
+    s_on_ms_hour = 0;
+    s_hour_start_ms = now_ms;
+    LOGI("gps: on-time %lu s in the last hour (%lu%%), lead=%lu s",
+         (unsigned long)s_st.on_s_last_hour,
+         (unsigned long)(s_st.on_s_last_hour * 100u / 3600u),
+         (unsigned long)s_st.lead_s);
+  }
+}
+
+static void pwr_set(bool on){
+  uint64_t now_ms = timebase_now_boot_ms();
+  pwr_account(now_ms);
+  if (on == s_on) return;
+  if (on){
+    gps_power_on_battery_on();
+    s_on_since_ms = now_ms;
+    s_st.cycles++;
+  } else {
+    gps_power_off_battery_on();
+  }
+  s_on = on;
+}
+
+// Wait for a fresh fix (with time) reported by the GPS driver
+static bool wait_fix(uint32_t timeout_s, uint32_t *ttf_ms){
+  uint64_t t0 = timebase_now_boot_ms();
+  xEventGroupClearBits(eg_system, EG_GPS_FIX);
+  EventBits_t b = xEventGroupWaitBits(eg_system, EG_GPS_FIX, pdTRUE, pdFALSE,
+                                      pdMS_TO_TICKS(timeout_s * 1000u));
+  *ttf_ms = (uint32_t)(timebase_now_boot_ms() - t0);
+  return (b & EG_GPS_FIX) != 0;
+}
+
+// Earliest UTC second >= from that something wants to transmit in
+static uint32_t next_tx_epoch(uint32_t from){
+  uint32_t best = from + GPS_MAX_OFF_S;
+
+  // WSPR minute mask: scan the coming hour for the first enabled minute
+  uint32_t t = ((from + 59u) / 60u) * 60u;
+  for (int i = 0; i < 61 && t < best; i++, t += 60u){
+    if (wspr_should_tx_in_minute((int)((t / 60u) % 60u))){ best = t; break; }
+  }
+
+  // Anything already on the arbiter's calendar (Horus, console tests, ...)
+  boot_us_t start;
+  utc_us_t u;
+  if (radio_arbiter_next_start(timebase_boot_now(), &start) && timebase_utc_at(start, &u)){
+    uint32_t e = utc_epoch(u);
+    if (e >= from && e < best) best = e;
+  }
+  return best;
+}
+
+static void update_lead(uint32_t ttf_ms){
+  s_st.last_ttf_ms = ttf_ms;
+  // EWMA, alpha = 1/4; seed with the first sample
+  s_ttf_avg_ms = s_ttf_avg_ms ? (s_ttf_avg_ms * 3u + ttf_ms) / 4u : ttf_ms;
+  uint32_t lead = (s_ttf_avg_ms + 999u) / 1000u + GPS_LEAD_MARGIN_S;
+  if (ttf_ms > s_ttf_avg_ms) {
+    // one slow start shouldn't make us late next time: cover the worst recent
+    uint32_t worst = (ttf_ms + 999u) / 1000u + GPS_LEAD_MARGIN_S;
+    if (worst > lead) lead = worst;
+  }
+  if (lead < GPS_LEAD_MIN_S) lead = GPS_LEAD_MIN_S;
+  if (lead > GPS_LEAD_MAX_S) lead = GPS_LEAD_MAX_S;
+  s_st.lead_s = lead;
+}
+
+static void gps_task(void *arg){
   (void)arg;
-  LOGI("gps: boot task running");
-  // Now it's safe to use vTaskDelay() inside any called functions
-  gps_enter_monitor_mode();
-  LOGI("gps: monitor mode requested");
-  vTaskDelete(NULL); // done
+  LOGI("gps: power manager running");
+  s_hour_start_ms = timebase_now_boot_ms();
+
+  // Cold start: configure, then hold power until we have time and position
+  s_on = true;
+  s_on_since_ms = s_hour_start_ms;
+  s_st.cycles = 1;
+  gps_enable_flight_mode();
+  uint32_t ttf;
+  while (!wait_fix(GPS_COLD_TIMEOUT_S, &ttf)){
+    LOGW("gps: no fix after %lu s (cold)", (unsigned long)(ttf / 1000u));
+  }
+  LOGI("gps: first fix after %lu ms", (unsigned long)ttf);
+
+  uint32_t served = timebase_utc_now();
+  for(;;){
+    vTaskDelay(pdMS_TO_TICKS(GPS_SETTLE_S * 1000u));
+
+    uint32_t now  = timebase_utc_now();
+    uint32_t next = next_tx_epoch((now > served ? now : served) + 1u);
+
+    // Skip the receiver for this window if the predictor still knows where
+    // we are and the timebase holdover still knows when.
+    uint32_t err = nav_predict_err_m(next);
+    uint32_t terr = timebase_error_us_at(next);
+    if (err < GPS_SKIP_ERR_M && terr < GPS_SKIP_TIME_US){
+      pwr_set(false);
+      LOGI("gps: window %lu from predictor (+/-%lu m, +/-%lu us)",
+           (unsigned long)next, (unsigned long)err, (unsigned long)terr);
+      s_st.skips++;
+      if (next > now) vTaskDelay(pdMS_TO_TICKS((next - now) * 1000u));
+      served = next;
+      continue;
+    }
+
+    uint32_t lead = s_st.lead_s;
+    uint32_t wake = (next > lead) ? next - lead : 0;
+
+    bool cycle = (wake > now + GPS_MIN_OFF_S);
+    if (cycle) pwr_set(false);
+    if (wake > now){
+      vTaskDelay(pdMS_TO_TICKS((wake - now) * 1000u));
+    }
+    pwr_set(true);
+
+    bool ok = wait_fix(GPS_HOT_TIMEOUT_S, &ttf);
+    pwr_account(timebase_now_boot_ms());
+    if (!ok){
+      LOGW("gps: no fix within %u s for window %lu", GPS_HOT_TIMEOUT_S, (unsigned long)next);
+      s_st.misses++;
+    } else if (cycle){
+      update_lead(ttf);
+      LOGI("gps: hot fix in %lu ms, lead now %lu s", (unsigned long)ttf, (unsigned long)s_st.lead_s);
+    }
+    served = next;
+  }
+}
+
+void gps_pwr_get_stats(gps_pwr_stats_t *out){
+  if (!out) return;
+  *out = s_st;
+  out->on = s_on;
+  uint32_t on_ms = s_on_ms_hour;
+  if (s_on) on_ms += (uint32_t)(timebase_now_boot_ms() - s_on_since_ms);
+  out->on_s_this_hour = on_ms / 1000u;
 }
 
 void task_gps_start(void){
   if (started) { LOGW("gps: task_gps_start called twice; ignoring"); return; }
   started = true;
 
-  LOGI("gps: scheduling boot task");
-  BaseType_t ok = xTaskCreate(
-    gps_boot_task, "gps_boot", 1024, NULL, tskIDLE_PRIORITY+2, NULL);
-  if (ok != pdPASS) {
-    LOGE("gps: FAILED to create boot task");
-  }
-}
\ No newline at end of file
+  static StackType_t stack[APP_STACK_GPS_PWR];
+  static StaticTask_t tcb;
+  LOGI("gps: scheduling power manager task");
+  app_task_create(gps_task, "gps_pwr", NULL, APP_PRIO_GPS_PWR, stack, APP_STACK_GPS_PWR, &tcb);
+}
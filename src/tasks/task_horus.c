@@ -0,0 +1,204 @@
+// src/tasks/task_horus.c -- Horus Binary v2 keyer
+//
+// A window is filled with packets back to back. While packet N is on the air,
+// packet N+1 is built into the other buffer from fresh data (position
+// predicted for its own start, the latest fix, the sensors) and queued on the
+// symbol player, which starts it on N's end edge from the same IRQ: no gap,
+// and every edge stays on the window's one schedule. The alarm path is used
+// rather than the DMA sequencer, which plays one frame at a time.
+#include "FreeRTOS.h"
+#include "task.h"
+#include "logging.h"
+#include "horus_encoder.h"
+#include "radio_hw.h"
+#include "timebase.h"
+#include "symbol_player.h"
+#include "msg_bus.h"
+#include "radio_arbiter.h"
+#include "nav_predict.h"
+#include "env_sensors.h"
+#include "app_rtos.h"
+#include "tasks/task_horus.h"
+#include <math.h>
+#include <stdatomic.h>
+
+// Written under a critical section, copied once per window
+static horus_cfg_t s_cfg = { .payload_id = 256, .baud = 100, .base_hz = 14097420, .step_hz = 270 };
+static horus_stats_t s_st;
+
+static uint8_t s_buf[2][HORUS_V2_PACKED_BYTES];   // on air / being built
+static uint16_t s_seq;
+
+static TaskHandle_t s_keyer_task = NULL;
+static _Atomic bool s_keyer_run = false;
+static boot_us_t s_win_start, s_win_end;          // set by horus_start before the kick
+
+void horus_cfg_get(horus_cfg_t *out){
+  taskENTER_CRITICAL();
+  *out = s_cfg;
+  taskEXIT_CRITICAL();
+}
+
+bool horus_cfg_set(const horus_cfg_t *cfg){
+  // The keyer hands the player step_hz * 1e6 uHz in a uint32
+  if (!cfg || (cfg->baud != 100 && cfg->baud != 300) || !cfg->base_hz || !cfg->step_hz ||
+      cfg->step_hz > UINT32_MAX / 1000000u)
+    return false;
+  taskENTER_CRITICAL();
+  s_cfg = *cfg;
+  taskEXIT_CRITICAL();
+  return true;
+}
+
+void horus_get_stats(horus_stats_t *out){
+  if (!out) return;
+  *out = s_st;
+  out->seq = s_seq;
+}
+
+// One packet as of boot instant `at` (its first symbol). The bus, timebase and
+// predictor snapshots are seqlock reads from priority 3; their writer (gpsmon)
+// copies inside a critical section, so a reader never catches it mid-write.
+static void packet_build(uint8_t *out, boot_us_t at, uint16_t payload_id){
+  telemetry_t t = {0};
+  gps_fix_t fix = {0};
+  utc_us_t u;
+  msg_bus_latest_fix(&fix, NULL);
+  t.gps.sats = fix.sats;
+  t.gps.unix_time = timebase_utc_at(at, &u) ? utc_epoch(u) : fix.unix_time;
+
+  // Where we'll be, not where the last fix was: the GPS may be off
+  nav_pos_t pos;
+  if (nav_predict_at(t.gps.unix_time, &pos)){
+    t.gps.fix_valid = 1;
+    t.gps.lat_e7 = pos.lat_e7;
+    t.gps.lon_e7 = pos.lon_e7;
+    t.gps.alt_cm = pos.alt_cm;
+    nav_predict_stats_t ns;
+    nav_predict_get_stats(&ns);
+    double v_cms = sqrt((double)ns.vn_cms * ns.vn_cms + (double)ns.ve_cms * ns.ve_cms);
+    t.speed_kph = (uint16_t)(v_cms * 0.036);
+  }
+
+  int16_t temp_c;
+  uint16_t volt_mv;
+  env_sensors_read(&temp_c, &volt_mv);
+  t.temp_c = (int8_t)(temp_c < -128 ? -128 : temp_c > 127 ? 127 : temp_c);
+  t.vbatt_v = volt_mv * 0.001f;
+
+  horus_v2_hdr_t h = { .payload_id = payload_id, .seq = s_seq++ };
+  horus_build_v2(&t, &h, out);
+}
+
+static void horus_keyer_task(void *arg){
+  (void)arg;
+  LOGI("[HORUS] keyer task up");
+
+  for(;;){
+    while (!atomic_load(&s_keyer_run)){
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+
+    horus_cfg_t c;
+    horus_cfg_get(&c);
+    // 1e6 / baud us a symbol, kept exact (300 baud: 10000/3)
+    uint64_t packet_us = (uint64_t)HORUS_V2_SYMS * 1000000u / c.baud;
+
+    radio_hw_select_outputs(1u);
+    radio_hw_enable(true);
+
+    // Packet 0 and the tone setup run in the booked lead; if they overrun
+    // it, the player moves the start up and the chain follows
+    boot_us_t t0 = s_win_start;
+    packet_build(s_buf[0], t0, c.payload_id);
+    symbol_play_t play = {
+      .symbols    = s_buf[0],
+      .n_symbols  = HORUS_V2_SYMS,
+      .base_hz    = c.base_hz,
+      .step_uhz   = c.step_hz * 1000000u,
+      .out        = 0,
+      .n_tones    = HORUS_TONES,
+      .period_num = 1000000u,
+      .period_den = c.baud,
+      .start      = t0,
+      .notify     = xTaskGetCurrentTaskHandle(),
+      .dma        = false,     // chains are alarm-path only
+    };
+    ulTaskNotifyTake(pdTRUE, 0);
+
+    uint32_t sent = 0, err_max = 0, n = 0;
+    if (!symbol_player_start(&play)){
+      LOGE("[HORUS] window MISSED: symbol player busy or packet invalid");
+    } else {
+      symbol_player_stats_t st;
+      symbol_player_get_stats(&st);
+      if (st.last_start_late_us){
+        LOGW("[HORUS] keyed %lu us after the booked start", (unsigned long)st.last_start_late_us);
+        t0 = boot_add_us(t0, st.last_start_late_us);
+      }
+      int64_t room = boot_diff_us(s_win_end, t0);
+      n = room > 0 ? (uint32_t)((uint64_t)room / packet_us) : 0;
+      if (!n){
+        LOGW("[HORUS] window too short for a packet");
+        symbol_player_abort();
+      } else {
+        // Packet i is built and queued while i-1 is on the air; each wake-up
+        // is one packet ending
+        for (uint32_t i = 1;; i++){
+          bool queued = false;
+          if (i < n && atomic_load(&s_keyer_run)){
+            packet_build(s_buf[i & 1], boot_add_us(t0, (int64_t)(i * packet_us)), c.payload_id);
+            play.symbols = s_buf[i & 1];
+            queued = symbol_player_queue(&play);
+            if (!queued && atomic_load(&s_keyer_run)){
+              s_st.underruns++;
+              LOGW("[HORUS] packet %lu not queued in time", (unsigned long)i);
+            }
+          }
+          ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+          symbol_player_get_stats(&st);
+          if (st.last_err_max_us > err_max) err_max = st.last_err_max_us;
+          if (atomic_load(&s_keyer_run)) sent++;
+          if (!queued) break;
+        }
+      }
+      while (symbol_player_busy()) ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+    }
+
+    radio_hw_enable(false);
+    atomic_store(&s_keyer_run, false);
+    s_st.windows++;
+    s_st.packets += sent;
+    s_st.last_packets = sent;
+    s_st.last_err_max_us = err_max;
+    LOGI("[HORUS] keyer done, %lu/%lu packets at %u baud, edge error max %lu us",
+         (unsigned long)sent, (unsigned long)n, c.baud, (unsigned long)err_max);
+  }
+}
+
+// ===== Arbiter callbacks =====
+void horus_start(void *user){
+  LOGI("[HORUS] START");
+  if (!s_keyer_task || atomic_load(&s_keyer_run)) { LOGE("[HORUS] keyer not ready"); return; }
+  (void)user;
+  // The window runs from its booked start, not from when we got here
+  if (!radio_arbiter_active_start(&s_win_start)) s_win_start = timebase_boot_now();
+  s_win_end = boot_add_us(s_win_start, HORUS_WINDOW_US);
+  atomic_store(&s_keyer_run, true);
+  xTaskNotifyGive(s_keyer_task);
+}
+
+void horus_stop(void *user){
+  (void)user;
+  LOGI("[HORUS] STOP");
+  atomic_store(&s_keyer_run, false);
+  symbol_player_abort();
+}
+
+void task_horus_start(void){
+  if (s_keyer_task) return;
+  static StackType_t stack[APP_STACK_HORUS_KEYER];
+  static StaticTask_t tcb;
+  s_keyer_task = app_task_create(horus_keyer_task, "horuskey", NULL, APP_PRIO_HORUS_KEYER,
+                                 stack, APP_STACK_HORUS_KEYER, &tcb);
+}
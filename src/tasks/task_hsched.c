@@ -4,42 +4,82 @@
 #include "logging.h"
 #include "timebase.h"
 #include "radio_arbiter.h"
+#include "msg_bus.h"
+#include "wspr_encoder.h"
+#include "app_rtos.h"
+#include "tasks/task_horus.h"
+#include "tasks/task_hsched.h"
 
-static void horus_start(void *user){ /* set SI5351, stream 4FSK symbols */ }
-static void horus_stop(void *user){  /* stop */ }
+// Arbiter verdicts on our windows; runs on the arbiter task, so only log
+static void horus_slot_status(void *user, radio_event_t ev, boot_us_t t_start){
+  static const char *const k_ev[] = { "accepted", "rejected", "preempted", "cancelled", "missed" };
+  (void)t_start;
+  if (ev != RADIO_EV_ACCEPTED)
+    LOGW("hsched: window %lu %s", (unsigned long)(uintptr_t)user, k_ev[ev]);
+}
+
+#define HSCHED_MARGIN_US 1000000   // clear of the WSPR window's guard
 
-#define HORUS_BURST_MS   50000  // 50s example; ensure < 60s if you want every odd minute
+// Where the window in odd minute `min` starts, in us after the minute; -1 if
+// it doesn't fit. A WSPR window on the even minute before runs 51 s into this
+// one (plus the mode guard); one on the even minute after is due its lead and
+// the guard before that minute.
+static int64_t window_offset_us(uint32_t min){
+  int64_t off = 0, limit = 120000000;    // the next odd minute's window
+  if (wspr_should_tx_in_minute((int)((min + 59) % 60)))
+    off = (int64_t)WSPR_WINDOW_US - 60000000 + RADIO_MODE_GUARD_US + HSCHED_MARGIN_US;
+  if (wspr_should_tx_in_minute((int)((min + 1) % 60)))
+    limit = 60000000 - (int64_t)WSPR_KEY_LEAD_US - RADIO_MODE_GUARD_US;
+  return off + HORUS_WINDOW_US <= limit ? off : -1;
+}
 
 static void hsched_task(void *arg){
   (void)arg;
   while (!timebase_is_valid()){ vTaskDelay(pdMS_TO_TICKS(500)); }
-  LOGI("hsched: UTC valid; scheduling Horus on odd minutes.");
+  LOGI("hsched: UTC valid; scheduling Horus on odd minutes, around WSPR.");
 
   for(;;){
-    uint64_t now_ms = timebase_now_ms();
-    uint32_t now_s  = (uint32_t)(now_ms/1000ULL);
-    uint32_t next   = (now_s/60)*60 + 60;  // next minute boundary
-    int32_t delta_ms = (int32_t)((int64_t)next*1000LL - (int64_t)now_ms);
-    if (delta_ms > 0) vTaskDelay(pdMS_TO_TICKS(delta_ms));
+    utc_us_t now;
+    boot_us_t start;
+    timebase_now(NULL, &now);
+    uint32_t next = (utc_epoch(now)/60)*60 + 60;  // next minute boundary
+    if (!timebase_boot_at(utc_from_epoch(next), &start)) { vTaskDelay(pdMS_TO_TICKS(1000)); continue; }
+    // book it a few seconds ahead so the arbiter has it before the boundary
+    timebase_delay_until(boot_add_us(start, -5000000));
 
     uint32_t min = (next/60) % 60;
     if ((min % 2) == 1) {  // odd minutes
-      radio_req_t r = {
-        .mode        = MODE_HORUS,
-        .t_start_ms  = (uint64_t)next * 1000ULL,
-        .duration_ms = HORUS_BURST_MS,     // must not overlap next even-minute WSPR
-        .freq_hz     = 14097420,
-        .start_cb    = horus_start,
-        .stop_cb     = horus_stop,
-        .user        = NULL,
-        .priority    = 1
-      };
-      // Ensure this burst fits: 50s leaves ~10s guard before the next even-minute WSPR slot opens.
-      (void)radio_arbiter_submit(&r);
+      int64_t off = window_offset_us(min);
+      tx_job_t *job = off < 0 ? NULL : msg_bus_tx_job_alloc();
+      if (off < 0) {
+        LOGI("hsched: skip %02u:%02u (WSPR on both sides)", (next/3600)%24, min);
+      } else if (!job) {
+        LOGW("hsched: no free TX job");
+      } else {
+        horus_cfg_t hc;
+        horus_cfg_get(&hc);
+        job->req = (radio_req_t){
+          .mode        = MODE_HORUS,
+          .t_start     = boot_add_us(start, off),
+          .duration_us = HORUS_WINDOW_US,
+          .lead_us     = HORUS_KEY_LEAD_US,
+          .freq_hz     = hc.base_hz,
+          .start_cb    = horus_start,
+          .stop_cb     = horus_stop,
+          .user        = (void *)(uintptr_t)next,
+          .status_cb   = horus_slot_status,
+          .priority    = 1
+        };
+        job->u.horus.slot_epoch = next;
+        if (!radio_arbiter_submit_job(job)) LOGW("hsched: submit failed for %02u:%02u", (next/3600)%24, min);
+      }
     }
+    timebase_delay_until(boot_add_us(start, 1000000));
   }
 }
 
 void task_hsched_start(void){
-  xTaskCreate(hsched_task, "hsched", 1024, NULL, tskIDLE_PRIORITY+1, NULL);
+  static StackType_t stack[APP_STACK_HSCHED];
+  static StaticTask_t tcb;
+  app_task_create(hsched_task, "hsched", NULL, APP_PRIO_HSCHED, stack, APP_STACK_HSCHED, &tcb);
 }
\ No newline at end of file
@@ -1,128 +1,371 @@
 // src/tasks/task_radio_arbiter.c
 #include "radio_arbiter.h"
+#include "radio_hw.h"
+#include "msg_bus.h"
 #include "timebase.h"
 #include "logging.h"
+#include "app_rtos.h"
 #include "FreeRTOS.h"
 #include "task.h"
 #include "queue.h"
 #include "semphr.h"
+#include <string.h>
 
-#define RADIO_Q_LEN 8
-
-typedef struct {
-  radio_req_t req;
-} q_item_t;
-
-static QueueHandle_t q_reqs;
 static SemaphoreHandle_t m_radio;
-
-static void si5351_init_once(void){ /* TODO */ }
-static void si5351_stop_all(void){ /* TODO */ }
+static radio_arbiter_stats_t s_st;
 
 static int cmp_req(const radio_req_t *a, const radio_req_t *b){
-  if (a->t_start_ms < b->t_start_ms) return -1;
-  if (a->t_start_ms > b->t_start_ms) return 1;
+  if (a->t_start.us < b->t_start.us) return -1;
+  if (a->t_start.us > b->t_start.us) return 1;
   // Same start: higher priority first
   if (a->priority > b->priority) return -1;
   if (a->priority < b->priority) return 1;
   return 0;
 }
 
-// naive small-array scheduler
-#define MAX_CAL 6
-static radio_req_t cal[MAX_CAL];
+// Calendar: bounded binary min-heap of pooled jobs (pointers only), ordered
+// by start, then priority. It can't hold more jobs than the pool has.
+#define CAL_CAP TX_JOB_POOL
+static tx_job_t *cal[CAL_CAP];
 static int cal_n = 0;
 
-static void cal_insert(const radio_req_t *r){
-  if (cal_n >= MAX_CAL) return;
-  int i=cal_n++;
-  cal[i]=*r;
-  // insertion sort
-  for (int j=i; j>0 && cmp_req(&cal[j], &cal[j-1])<0; --j){
-    radio_req_t t = cal[j]; cal[j]=cal[j-1]; cal[j-1]=t;
+static bool cal_less(int a, int b){ return cmp_req(&cal[a]->req, &cal[b]->req) < 0; }
+static void cal_swap(int a, int b){ tx_job_t *t = cal[a]; cal[a] = cal[b]; cal[b] = t; }
+
+static void sift_up(int i){
+  while (i > 0){
+    int p = (i - 1) / 2;
+    if (!cal_less(i, p)) break;
+    cal_swap(i, p);
+    i = p;
   }
 }
 
+static void sift_down(int i){
+  for (;;){
+    int l = 2*i + 1, r = l + 1, m = i;
+    if (l < cal_n && cal_less(l, m)) m = l;
+    if (r < cal_n && cal_less(r, m)) m = r;
+    if (m == i) break;
+    cal_swap(i, m);
+    i = m;
+  }
+}
+
+// cal[] is written only by radio_task but read by other tasks
+// (radio_arbiter_next_start), so edits happen in short critical sections.
+static bool cal_insert(tx_job_t *j){
+  if (cal_n >= CAL_CAP) return false;
+  taskENTER_CRITICAL();
+  cal[cal_n] = j;
+  sift_up(cal_n++);
+  taskEXIT_CRITICAL();
+  if (cal_n > s_st.booked_max) s_st.booked_max = (uint16_t)cal_n;
+  return true;
+}
+
+// Unlinks entry i; the caller owns the job. Moves other entries, so scans
+// that remove must restart.
+static tx_job_t *cal_unlink(int i){
+  tx_job_t *j = cal[i];
+  taskENTER_CRITICAL();
+  if (i != --cal_n){
+    cal[i] = cal[cal_n];
+    sift_down(i);
+    sift_up(i);
+  }
+  taskEXIT_CRITICAL();
+  return j;
+}
+
+bool radio_arbiter_next_start(boot_us_t after, boot_us_t *t_start){
+  bool have = false;
+  taskENTER_CRITICAL();
+  for (int i=0;i<cal_n;i++){
+    boot_us_t t = cal[i]->req.t_start;
+    if (!boot_before(t, after) && (!have || boot_before(t, *t_start))){ *t_start = t; have = true; }
+  }
+  taskEXIT_CRITICAL();
+  return have;
+}
+
+static uint32_t guard_us(const radio_req_t *a, const radio_req_t *b){
+  return (a->mode != b->mode) ? RADIO_MODE_GUARD_US : 0;
+}
+
+// start_cb is due lead_us ahead of the start; the window holds the radio
+// from then on
+static boot_us_t req_due(const radio_req_t *r){
+  return boot_add_us(r->t_start, -(int64_t)r->lead_us);
+}
+
+// Windows conflict if they overlap, or sit closer than the mode guard
 static bool overlaps(const radio_req_t *a, const radio_req_t *b){
-  uint64_t a_end = a->t_start_ms + a->duration_ms;
-  uint64_t b_end = b->t_start_ms + b->duration_ms;
-  return !(a_end <= b->t_start_ms || b_end <= a->t_start_ms);
+  uint64_t g = guard_us(a, b);
+  uint64_t a_end = a->t_start.us + a->duration_us + g;
+  uint64_t b_end = b->t_start.us + b->duration_us + g;
+  return !(a_end <= req_due(b).us || b_end <= req_due(a).us);
+}
+
+// ---- intake: submissions come through q_tx_jobs, cancels through a small
+// ring; either one notifies the task so it re-plans without polling ----
+#define ARB_EV_JOBS   (1u << 0)
+#define ARB_EV_CANCEL (1u << 1)
+#define MAX_CANCEL    4
+#define LATE_MAX_US   1000000u   // a window starting later than this is dropped
+
+typedef struct { radio_mode_t mode; uint32_t slot_epoch; } cancel_req_t;
+
+static TaskHandle_t s_task;
+static cancel_req_t s_cancel[MAX_CANCEL];
+static int s_cancel_n = 0;
+
+// The window on the air right now (not in cal[]) and when it ends
+static tx_job_t *s_active;
+static boot_us_t s_active_end;
+
+static void arb_notify(uint32_t ev){
+  if (s_task) xTaskNotify(s_task, ev, eSetBits);
+}
+
+bool radio_arbiter_submit_job(tx_job_t *job){
+  if (!msg_bus_tx_job_post(job)) return false;
+  arb_notify(ARB_EV_JOBS);
+  return true;
 }
 
 bool radio_arbiter_submit(const radio_req_t *req){
-  if (!q_reqs) return false;
-  q_item_t it = { .req = *req };
-  return xQueueSend(q_reqs, &it, 0) == pdPASS;
+  tx_job_t *j = msg_bus_tx_job_alloc();
+  if (!j) return false;
+  j->req = *req;
+  return radio_arbiter_submit_job(j);
 }
 
-static void radio_task(void *arg){
-  (void)arg;
-  si5351_init_once();
-  si5351_stop_all();
+bool radio_arbiter_cancel(radio_mode_t mode, uint32_t slot_epoch){
+  bool ok = false;
+  taskENTER_CRITICAL();
+  if (s_cancel_n < MAX_CANCEL){
+    s_cancel[s_cancel_n++] = (cancel_req_t){ mode, slot_epoch };
+    ok = true;
+  }
+  taskEXIT_CRITICAL();
+  if (ok) arb_notify(ARB_EV_CANCEL);
+  else LOGW("radio: cancel ring full");
+  return ok;
+}
 
-  for(;;){
-    // 1) drain queue
-    q_item_t it;
-    while (xQueueReceive(q_reqs, &it, 0) == pdPASS){
-      // check overlap policy vs calendar
-      bool ok = true;
-      for (int i=0;i<cal_n;i++){
-        if (overlaps(&it.req, &cal[i])){
-          // priority rule
-          if (it.req.priority > cal[i].priority){
-            // preempt existing (simple: drop the old one)
-            // In production, you might signal the old client it's been rejected.
-            for (int k=i;k<cal_n-1;k++) cal[k]=cal[k+1];
-            cal_n--;
-          } else {
-            ok = false; break;
-          }
-        }
-      }
-      if (ok) cal_insert(&it.req);
-    }
+static uint32_t job_slot(const tx_job_t *j){
+  return j->req.mode == MODE_WSPR ? j->u.wspr.slot_epoch : j->u.horus.slot_epoch;
+}
+
+static bool job_matches(const tx_job_t *j, const cancel_req_t *c){
+  return j->req.mode == c->mode && (c->slot_epoch == 0 || job_slot(j) == c->slot_epoch);
+}
+
+static radio_mode_stats_t *mode_st(const radio_req_t *r){
+  return &s_st.mode[r->mode == MODE_WSPR ? MODE_WSPR : MODE_HORUS];
+}
+
+static void job_event(const tx_job_t *j, radio_event_t ev){
+  if (j->req.status_cb) j->req.status_cb(j->req.user, ev, j->req.t_start);
+}
 
-    // 2) wake for the next event
-    if (cal_n == 0) {
-      vTaskDelay(pdMS_TO_TICKS(100));
-      continue;
+// Counts the outcome, tells the owner and returns the job to the pool
+static void job_drop(tx_job_t *j, radio_event_t ev){
+  radio_mode_stats_t *m = mode_st(&j->req);
+  switch (ev){
+  case RADIO_EV_REJECTED:  m->rejected++;  break;
+  case RADIO_EV_PREEMPTED: m->preempted++; break;
+  case RADIO_EV_CANCELLED: m->cancelled++; break;
+  case RADIO_EV_MISSED:    m->missed++;    break;
+  default: break;
+  }
+  job_event(j, ev);
+  msg_bus_tx_job_free(j);
+}
+
+// ---- window lifecycle ----
+
+static const char *mode_name(const radio_req_t *r){
+  return r->mode == MODE_WSPR ? "WSPR" : "Horus";
+}
+
+static void window_missed(tx_job_t *j, radio_miss_t cause, uint32_t late){
+  s_st.miss[cause]++;
+  if (cause == RADIO_MISS_LATE)
+    LOGW("radio: %s slot %lu MISSED: late by %lu ms", mode_name(&j->req),
+         (unsigned long)job_slot(j), (unsigned long)(late / 1000u));
+  else
+    LOGE("radio: %s slot %lu MISSED: HW lock timeout", mode_name(&j->req),
+         (unsigned long)job_slot(j));
+  job_drop(j, RADIO_EV_MISSED);
+}
+
+static void run_cb(void (*cb)(void *), void *user){
+  if (!cb) return;
+  boot_us_t t0 = timebase_boot_now();
+  cb(user);
+  timing_hist_add(&s_st.cb, (uint32_t)boot_diff_us(timebase_boot_now(), t0));
+}
+
+static void window_start(void){
+  tx_job_t *j = cal_unlink(0);
+  radio_req_t *r = &j->req;
+  uint32_t late = (uint32_t)boot_diff_us(timebase_boot_now(), req_due(r));
+  if (late > LATE_MAX_US){
+    timing_hist_add(&s_st.late, late);
+    window_missed(j, RADIO_MISS_LATE, late);
+    return;
+  }
+  if (!m_radio || xSemaphoreTake(m_radio, pdMS_TO_TICKS(500)) != pdTRUE){
+    window_missed(j, RADIO_MISS_HW_LOCK, late);
+    return;
+  }
+  // after the lock: what the window actually sees
+  timing_hist_add(&s_st.late, (uint32_t)boot_diff_us(timebase_boot_now(), req_due(r)));
+  mode_st(r)->windows++;
+  LOGI("radio: %s window, slot %lu", mode_name(r), (unsigned long)job_slot(j));
+
+  s_active = j;
+  s_active_end = boot_add_us(r->t_start, r->duration_us);
+  run_cb(r->start_cb, r->user);
+}
+
+bool radio_arbiter_active_start(boot_us_t *t_start){
+  if (!s_active || !t_start) return false;
+  *t_start = s_active->req.t_start;
+  return true;
+}
+
+// Takes the window off the air, on time or early (cancel / preempt); the
+// caller disposes of the job
+static tx_job_t *window_end(void){
+  tx_job_t *j = s_active;
+  if (boot_before(timebase_boot_now(), s_active_end)) s_st.aborted++;
+  run_cb(j->req.stop_cb, j->req.user);
+  radio_hw_stop_all();      // whatever the keyer left on, off now
+  xSemaphoreGive(m_radio);
+  s_active = NULL;
+  return j;
+}
+
+// Latest end (+ guard, + q's lead) of the windows q conflicts with but can't
+// displace, i.e. q's earliest start after them; false if nothing blocks it
+static bool blocked_until(const radio_req_t *q, boot_us_t *next){
+  bool blocked = false;
+  for (int i=-1;i<cal_n;i++){
+    const radio_req_t *o = (i < 0) ? (s_active ? &s_active->req : NULL) : &cal[i]->req;
+    if (!o || o->priority < q->priority || !overlaps(q, o)) continue;
+    boot_us_t e = boot_add_us(o->t_start, (int64_t)o->duration_us + guard_us(q, o) + q->lead_us);
+    if (!blocked || boot_before(*next, e)) *next = e;
+    blocked = true;
+  }
+  return blocked;
+}
+
+// Rank one new job against the active window and the calendar: slide it
+// into a gap within its slack if it's blocked, then displace whatever
+// lower-priority windows are left in its way.
+static void intake(tx_job_t *it){
+  radio_req_t *q = &it->req;
+  boot_us_t want = q->t_start, next;
+  while (blocked_until(q, &next)){
+    if (boot_diff_us(next, want) > (int64_t)q->slack_us){
+      job_drop(it, RADIO_EV_REJECTED);
+      return;
     }
+    q->t_start = next;
+  }
+  if (cal_n >= CAL_CAP){
+    LOGW("radio: calendar full (%d)", CAL_CAP);
+    job_drop(it, RADIO_EV_REJECTED);
+    return;
+  }
 
-    radio_req_t *r = &cal[0];
-    int32_t ms_until = (int32_t)((int64_t)r->t_start_ms - (int64_t)timebase_now_ms());
-    if (ms_until > 0){
-      int chunk = ms_until > 50 ? 50 : ms_until; // fine-grain wait
-      vTaskDelay(pdMS_TO_TICKS(chunk));
-      continue;
+  if (s_active && overlaps(q, &s_active->req)){
+    LOGI("radio: slot %lu preempted on air", (unsigned long)job_slot(s_active));
+    job_drop(window_end(), RADIO_EV_PREEMPTED);
+  }
+  for (int i=0;i<cal_n;i++){
+    if (overlaps(q, &cal[i]->req)){
+      job_drop(cal_unlink(i), RADIO_EV_PREEMPTED);
+      i = -1;   // heap moved: rescan
     }
+  }
+  cal_insert(it);
+  mode_st(q)->admitted++;
+  job_event(it, RADIO_EV_ACCEPTED);
+}
 
-    // 3) execute current window
-    // lock hardware
-    if (m_radio && xSemaphoreTake(m_radio, pdMS_TO_TICKS(500)) == pdTRUE){
-      if (r->start_cb) r->start_cb(r->user);
+static void apply_cancels(void){
+  cancel_req_t c[MAX_CANCEL];
+  taskENTER_CRITICAL();
+  int n = s_cancel_n;
+  for (int i=0;i<n;i++) c[i] = s_cancel[i];
+  s_cancel_n = 0;
+  taskEXIT_CRITICAL();
 
-      uint32_t dur = r->duration_ms;
-      while ((int32_t)dur > 0){
-        uint32_t sl = dur > 20 ? 20 : dur;
-        vTaskDelay(pdMS_TO_TICKS(sl));
-        dur -= sl;
+  for (int k=0;k<n;k++){
+    if (s_active && job_matches(s_active, &c[k])){
+      LOGI("radio: slot %lu cancelled on air", (unsigned long)job_slot(s_active));
+      job_drop(window_end(), RADIO_EV_CANCELLED);
+    }
+    for (int i=0;i<cal_n;i++){
+      if (job_matches(cal[i], &c[k])){
+        job_drop(cal_unlink(i), RADIO_EV_CANCELLED);
+        i = -1;
       }
+    }
+  }
+}
+
+static void radio_task(void *arg){
+  (void)arg;
+  radio_hw_stop_all();      // radio_hw_init() ran in main()
+
+  for(;;){
+    // 1) take in everything submitted or withdrawn since the last pass;
+    //    this runs during windows too, so the queue never backs up
+    tx_job_t *it;
+    while ((it = msg_bus_tx_job_receive(0)) != NULL) intake(it);
+    apply_cancels();
 
-      if (r->stop_cb) r->stop_cb(r->user);
-      si5351_stop_all();
-      xSemaphoreGive(m_radio);
-    } else {
-      LOGE("radio: failed to lock HW");
+    // 2) advance the window state machine
+    boot_us_t now = timebase_boot_now();
+    if (s_active && !boot_before(now, s_active_end)) msg_bus_tx_job_free(window_end());
+    if (!s_active && cal_n > 0 && !boot_before(now, req_due(&cal[0]->req))){
+      window_start();
+      continue;   // re-plan from the new state
     }
 
-    // 4) remove it
-    for (int k=0;k<cal_n-1;k++) cal[k]=cal[k+1];
-    cal_n--;
+    // 3) one wait to the next deadline; a submit or cancel cuts it short
+    TickType_t wait = portMAX_DELAY;
+    if (s_active) wait = timebase_ticks_until(s_active_end);
+    else if (cal_n > 0) wait = timebase_ticks_until(req_due(&cal[0]->req));
+    if (wait == 0) continue;
+    uint32_t ev;
+    xTaskNotifyWait(0, UINT32_MAX, &ev, wait);
   }
 }
 
+void radio_arbiter_get_stats(radio_arbiter_stats_t *out){
+  if (!out) return;
+  *out = s_st;
+  out->booked = (uint16_t)cal_n;
+}
+
+void radio_arbiter_reset_stats(void){
+  taskENTER_CRITICAL();
+  memset(&s_st, 0, sizeof(s_st));
+  s_st.booked_max = (uint16_t)cal_n;
+  taskEXIT_CRITICAL();
+}
+
 void task_radio_arbiter_start(void){
-  q_reqs = xQueueCreate(RADIO_Q_LEN, sizeof(q_item_t));
-  m_radio = xSemaphoreCreateMutex();
-  xTaskCreate(radio_task, "radioarb", 1536, NULL, tskIDLE_PRIORITY+3, NULL);
+  static StaticSemaphore_t mtx_buf;
+  static StackType_t stack[APP_STACK_RADIO_ARB];
+  static StaticTask_t tcb;
+  m_radio = xSemaphoreCreateMutexStatic(&mtx_buf);
+  app_rtos_register("m_radio", sizeof(mtx_buf));
+  s_task = app_task_create(radio_task, "radioarb", NULL, APP_PRIO_RADIO_ARB, stack, APP_STACK_RADIO_ARB, &tcb);
 }
\ No newline at end of file
@@ -5,17 +5,42 @@
 #include "timebase.h"
 #include "radio_arbiter.h"
 #include "wspr_encoder.h"
+#include "msg_bus.h"
+#include "nav_predict.h"
+#include "app_rtos.h"
+#include "env_sensors.h"
+#include <math.h>
 
-static void wspr_start(void *user){ /* set SI5351 base freq, symbol task kickoff */ }
-static void wspr_stop(void *user){  /* disable outputs, cleanup */ }
-
-extern uint32_t wspr_get_rf_base_hz(void);
 extern void wspr_start(void *user);
 extern void wspr_stop(void *user);
 
+// Arbiter verdicts on our slots; runs on the arbiter task, so only log
+static void wspr_slot_status(void *user, radio_event_t ev, boot_us_t t_start){
+  static const char *const k_ev[] = { "accepted", "rejected", "preempted", "cancelled", "missed" };
+  (void)t_start;
+  if (ev != RADIO_EV_ACCEPTED)
+    LOGW("wsched: slot %lu %s", (unsigned long)(uintptr_t)user, k_ev[ev]);
+}
+
+// Telemetry as it will be at the slot: predicted altitude, the rate
+// estimate's ground speed, and whether the GPS is keeping up
+static void slot_telem(const nav_pos_t *pos, wspr_telem_t *tm){
+  nav_predict_stats_t ns;
+  gps_fix_t fix = {0};
+  nav_predict_get_stats(&ns);
+  msg_bus_latest_fix(&fix, NULL);
+  double v_cms = sqrt((double)ns.vn_cms * ns.vn_cms + (double)ns.ve_cms * ns.ve_cms);
+  *tm = (wspr_telem_t){
+    .alt_m     = pos ? pos->alt_cm / 100 : 0,
+    .speed_kt  = (uint16_t)(v_cms / 51.444),
+    .gps_valid = pos && fix.fix_valid && pos->age_s <= 600,
+    .sats_ok   = fix.sats >= 8,
+  };
+  env_sensors_read(&tm->temp_c, &tm->volt_mv);
+}
+
 static uint32_t next_even_boundary(uint32_t now){
   uint32_t m = (now/60)%60, s = now%60;
-  uint32_t base = now - s;
   if ((m & 1)==0 && s==0) return now;      // exactly on even minute
   return now + ((m & 1) ? (60 - s) : (120 - s));
 }
@@ -27,30 +52,53 @@ static void queue_wspr_epoch(uint32_t start_epoch){
     return;
   }
 
-  uint64_t start_boot_ms = timebase_epoch_to_boot_ms(start_epoch);
-  if (!start_boot_ms){
+  boot_us_t start_boot;
+  if (!timebase_boot_at(utc_from_epoch(start_epoch), &start_boot)){
     LOGW("wsched: UTC not mapped yet, skipping");
     return;
   }
 
-  radio_req_t r = {
+  // Grid for where we'll be at the slot, not where the last fix was
+  nav_pos_t pos;
+  bool have_pos = nav_predict_at(start_epoch, &pos);
+  if (have_pos) {
+    wspr_update_grid_from_latlon(pos.lat_e7 * 1e-7, pos.lon_e7 * 1e-7);
+    if (pos.age_s > 60)
+      LOGI("wsched: predicted position, fix %lu s old, +/-%lu m",
+           (unsigned long)pos.age_s, (unsigned long)pos.err_m);
+  }
+
+  // Which message this window carries (rotation), built now
+  wspr_telem_t tm;
+  slot_telem(have_pos ? &pos : NULL, &tm);
+  uint32_t freq_hz = wspr_prepare_slot(start_epoch, &tm);
+
+  tx_job_t *job = msg_bus_tx_job_alloc();
+  if (!job) {
+    LOGW("wsched: no free TX job for epoch %u", start_epoch);
+    return;
+  }
+  job->req = (radio_req_t){
     .mode        = MODE_WSPR,
-    .t_start_ms  = start_boot_ms,
-    .duration_ms = 111000,
-    .freq_hz     = wspr_get_rf_base_hz(),
+    .t_start     = start_boot,
+    .duration_us = WSPR_WINDOW_US,
+    .lead_us     = WSPR_KEY_LEAD_US,
+    .freq_hz     = freq_hz,
     .start_cb    = wspr_start,
     .stop_cb     = wspr_stop,
-    .user        = NULL,
+    .user        = (void *)(uintptr_t)start_epoch,
+    .status_cb   = wspr_slot_status,
     .priority    = 2
   };
+  job->u.wspr.slot_epoch = start_epoch;
 
-  if (radio_arbiter_submit(&r)) {
-    LOGI("wsched: queued WSPR %02u:%02u:%02u (boot_ms=%llu)",
+  if (radio_arbiter_submit_job(job)) {
+    LOGI("wsched: queued WSPR %02u:%02u:%02u (boot_us=%llu)",
          (start_epoch/3600)%24, (start_epoch/60)%60, start_epoch%60,
-         (unsigned long long)start_boot_ms);
+         (unsigned long long)start_boot.us);
   } else {
-    LOGW("wsched: submit failed for epoch %u (boot_ms=%llu)",
-         start_epoch, (unsigned long long)start_boot_ms);
+    LOGW("wsched: submit failed for epoch %u (boot_us=%llu)",
+         start_epoch, (unsigned long long)start_boot.us);
   }
 }
 
@@ -73,11 +121,15 @@ static void wsched_task(void *arg){
 
     queue_wspr_epoch(start);
 
-    // Sleep ~2 minutes; if you want to be exact, compute precise delay:
-    vTaskDelay(pdMS_TO_TICKS(120000));
+    // Sleep until just past this slot's start, then plan the next one
+    boot_us_t b;
+    if (timebase_boot_at(utc_from_epoch(start + 1), &b)) timebase_delay_until(b);
+    else vTaskDelay(pdMS_TO_TICKS(1000));
   }
 }
 
 void task_wsched_start(void){
-  xTaskCreate(wsched_task, "wsched", 1024, NULL, tskIDLE_PRIORITY+1, NULL);
+  static StackType_t stack[APP_STACK_WSCHED];
+  static StaticTask_t tcb;
+  app_task_create(wsched_task, "wsched", NULL, APP_PRIO_WSCHED, stack, APP_STACK_WSCHED, &tcb);
 }
\ No newline at end of file
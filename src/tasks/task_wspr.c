@@ -1,35 +1,221 @@
 #include "FreeRTOS.h"
 #include "task.h"
+#include "semphr.h"
 #include "logging.h"
-#include "pico/time.h"        // absolute_time_t, sleep_until, get_absolute_time
 #include "wspr_encoder.h"
 #include "radio_hw.h"
+#include "timebase.h"
+#include "symbol_player.h"
+#include "app_rtos.h"
+#include "radio_arbiter.h"
 #include <string.h>
 #include <math.h>
 #include <stdatomic.h>
 
 // ===== Live config (editable at runtime via your console or GPS) =====
-static wspr_cfg_t g_cfg = { "KI5YNG", "EM53", 13 };
+static wspr_cfg_t g_cfg = { "KI5YNG", "EM53", 13, "Q0" };
 
-// RF plan: lower tone (symbol 0) frequency in Hz and tone spacing in micro-Hz
-static _Atomic uint32_t g_rf_base_hz = 140956000;   // EXAMPLE: set this to your band/slot later
+// What the next slot sends (wspr_prepare_slot); written under s_cfg_mtx
+static wspr_msg_t   s_plan_type = WSPR_MSG_TYPE1;
+static wspr_telem_t s_plan_tm;
+static wspr_band_t  s_plan_band[2] = { { 140956000, 0x1F, 0 } };   // [1].base_hz 0 = one band
+
+// RF plan: per band, the lower tone (symbol 0) frequency in Hz, the windows
+// it owns and its output; one tone spacing in micro-Hz for all. Band 0 is
+// what the single-band setters (rf base, win) edit. Writes under s_cfg_mtx.
+static wspr_band_t s_bands[WSPR_BANDS_MAX] = {
+  { 140956000, 0x1F, 0 },    // EXAMPLE: set this to your band/slot later
+};
+static uint8_t s_n_bands = 1;
 static _Atomic uint32_t g_tone_step_uHz = 1464844;  // 1.464844 Hz in micro-Hz (standard WSPR)
 
+// ===== Frame cache =====
+// Symbols for the current (call, grid, power, type, telemetry), rebuilt by
+// whoever changes an input -- the console, or wsched a slot ahead -- so key-up
+// only picks up a pointer. Three slots: the published one, the one on the air
+// and one to build into; a build never touches a frame in use.
+#define WSPR_CACHE_SLOTS   3
+
+typedef struct {
+  wspr_cfg_t   cfg;
+  wspr_msg_t   type;
+  wspr_telem_t tm;          // telemetry frames only
+  uint8_t      symbols[WSPR_PACKED_BYTES];
+} wspr_cached_frame_t;
+
+static wspr_cached_frame_t s_cache[WSPR_CACHE_SLOTS];
+static wspr_cached_frame_t *s_ready;     // newest good build; NULL until the first
+static wspr_cached_frame_t *s_on_air;    // the keyer's frame until it's done
+static SemaphoreHandle_t s_cfg_mtx;      // g_cfg and builds; never taken at key-up
+static wspr_cache_stats_t s_cache_st;
+
+static bool cache_key_eq(const wspr_cached_frame_t *f, const wspr_cfg_t *cfg,
+                         wspr_msg_t type, const wspr_telem_t *tm){
+  if (f->type != type || f->cfg.power_dbm != cfg->power_dbm ||
+      strcmp(f->cfg.callsign, cfg->callsign) || strcmp(f->cfg.grid, cfg->grid)) return false;
+  if (type != WSPR_MSG_TELEM) return true;
+  return !strcmp(f->cfg.telem_id, cfg->telem_id) && f->tm.alt_m == tm->alt_m &&
+         f->tm.speed_kt == tm->speed_kt && f->tm.temp_c == tm->temp_c &&
+         f->tm.volt_mv == tm->volt_mv && f->tm.gps_valid == tm->gps_valid &&
+         f->tm.sats_ok == tm->sats_ok;
+}
+
+// Encode g_cfg as the planned message into a free slot and publish it.
+// Caller holds s_cfg_mtx (or runs before the scheduler), so builds are
+// serialised.
+static bool cache_rebuild(void){
+  wspr_cached_frame_t *f = NULL;
+  taskENTER_CRITICAL();
+  for (int i = 0; i < WSPR_CACHE_SLOTS && !f; i++)
+    if (&s_cache[i] != s_ready && &s_cache[i] != s_on_air) f = &s_cache[i];
+  taskEXIT_CRITICAL();
+
+  if (!wspr_build_msg(&g_cfg, s_plan_type, &s_plan_tm, f->symbols)){
+    s_cache_st.build_fail++;
+    LOGE("[WSPR] %s build failed (call=%s grid=%s pwr=%d)", wspr_msg_name(s_plan_type),
+         g_cfg.callsign, g_cfg.grid, g_cfg.power_dbm);
+    return false;
+  }
+  f->cfg = g_cfg;
+  f->type = s_plan_type;
+  f->tm = s_plan_tm;
+
+  taskENTER_CRITICAL();
+  s_ready = f;
+  taskEXIT_CRITICAL();
+  s_cache_st.rebuilds++;
+  return true;
+}
+
+static void cfg_lock(void){ if (s_cfg_mtx) xSemaphoreTake(s_cfg_mtx, portMAX_DELAY); }
+static void cfg_unlock(void){ if (s_cfg_mtx) xSemaphoreGive(s_cfg_mtx); }
+
 // ===== Public setters (you already used some) =====
+// Each rebuilds the cache only if the value actually changed (wsched sets the
+// grid before every slot; it mostly doesn't move).
 void wspr_set_callsign(const char *cs){
   if (!cs) return;
-  strncpy(g_cfg.callsign, cs, sizeof(g_cfg.callsign)-1);
-  g_cfg.callsign[sizeof(g_cfg.callsign)-1]=0;
+  cfg_lock();
+  if (strncmp(g_cfg.callsign, cs, sizeof(g_cfg.callsign)-1)){
+    strncpy(g_cfg.callsign, cs, sizeof(g_cfg.callsign)-1);
+    g_cfg.callsign[sizeof(g_cfg.callsign)-1]=0;
+    cache_rebuild();
+  }
+  cfg_unlock();
 }
 void wspr_set_grid(const char *grid){
   if (!grid) return;
-  strncpy(g_cfg.grid, grid, sizeof(g_cfg.grid)-1);
-  g_cfg.grid[sizeof(g_cfg.grid)-1]=0;
+  cfg_lock();
+  if (strncmp(g_cfg.grid, grid, sizeof(g_cfg.grid)-1)){
+    strncpy(g_cfg.grid, grid, sizeof(g_cfg.grid)-1);
+    g_cfg.grid[sizeof(g_cfg.grid)-1]=0;
+    cache_rebuild();
+  }
+  cfg_unlock();
+}
+void wspr_set_power_dbm(int dbm){
+  cfg_lock();
+  if (g_cfg.power_dbm != dbm){
+    g_cfg.power_dbm = dbm;
+    cache_rebuild();
+  }
+  cfg_unlock();
+}
+
+void wspr_set_telem_id(const char *id){
+  if (!id) return;
+  cfg_lock();
+  if (strncmp(g_cfg.telem_id, id, sizeof(g_cfg.telem_id)-1)){
+    strncpy(g_cfg.telem_id, id, sizeof(g_cfg.telem_id)-1);
+    g_cfg.telem_id[sizeof(g_cfg.telem_id)-1]=0;
+    if (s_plan_type == WSPR_MSG_TELEM) cache_rebuild();
+  }
+  cfg_unlock();
+}
+
+// ===== Band plan =====
+// The windows are the union of the band masks. Caller holds s_cfg_mtx.
+static void bands_changed(void){
+  uint32_t m = 0;
+  for (uint8_t i = 0; i < s_n_bands; i++) m |= s_bands[i].minute_mask;
+  wspr_minutes_mask_set(m);
 }
-void wspr_set_power_dbm(int dbm){ g_cfg.power_dbm = dbm; }
 
-void wspr_set_rf_base_hz(uint32_t hz){ atomic_store(&g_rf_base_hz, hz); }
-uint32_t wspr_get_rf_base_hz(void){ return atomic_load(&g_rf_base_hz); }
+static uint8_t band_pll(const wspr_band_t *b){ return b->out ? 1 : 0; }
+
+bool wspr_band_set(uint8_t i, const wspr_band_t *b){
+  if (!b || i >= WSPR_BANDS_MAX || i > s_n_bands || b->out >= RADIO_HW_OUTPUTS) return false;
+  cfg_lock();
+  s_bands[i] = *b;
+  if (i == s_n_bands) s_n_bands++;
+  bands_changed();
+  cfg_unlock();
+  return true;
+}
+
+bool wspr_band_get(uint8_t i, wspr_band_t *out){
+  if (!out || i >= s_n_bands) return false;
+  cfg_lock();
+  *out = s_bands[i];
+  cfg_unlock();
+  return true;
+}
+
+uint8_t wspr_band_count(void){ return s_n_bands; }
+
+// Bands owning the slot's minute, in table order: the first, plus the next
+// one on the other PLL, which keys the same frame at the same time. Others
+// sharing the minute lose it. Caller holds s_cfg_mtx.
+static void plan_bands(uint32_t slot_epoch, wspr_band_t plan[2]){
+  uint32_t bit = 1u << ((slot_epoch / 120u) % 30u);
+  int first = -1, second = -1;
+  for (int i = 0; i < s_n_bands; i++){
+    if (!(s_bands[i].minute_mask & bit)) continue;
+    if (first < 0) first = i;
+    else if (second < 0 && band_pll(&s_bands[i]) != band_pll(&s_bands[first])) second = i;
+    else LOGW("[WSPR] slot %lu: band %d dropped, no free PLL", (unsigned long)slot_epoch, i);
+  }
+  plan[0] = s_bands[first < 0 ? 0 : first];
+  plan[1] = second < 0 ? (wspr_band_t){0} : s_bands[second];
+}
+
+// Plan the slot's message and bands and have its frame ready. Runs right
+// after the previous slot keyed up, so the frame on the air is already
+// claimed. Returns the first band's base frequency.
+uint32_t wspr_prepare_slot(uint32_t slot_epoch, const wspr_telem_t *tm){
+  wspr_band_t bands[2];
+  cfg_lock();
+  wspr_msg_t type = wspr_plan_msg(slot_epoch, &g_cfg);
+  plan_bands(slot_epoch, bands);
+  taskENTER_CRITICAL();
+  s_plan_type = type;
+  s_plan_band[0] = bands[0];
+  s_plan_band[1] = bands[1];
+  if (tm) s_plan_tm = *tm;
+  bool fresh = s_ready && cache_key_eq(s_ready, &g_cfg, s_plan_type, &s_plan_tm);
+  taskEXIT_CRITICAL();
+  if (!fresh) cache_rebuild();
+  cfg_unlock();
+  if (bands[1].base_hz)
+    LOGI("[WSPR] slot %lu: %s on %lu Hz (CLK%u) + %lu Hz (CLK%u)", (unsigned long)slot_epoch,
+         wspr_msg_name(type), (unsigned long)bands[0].base_hz, bands[0].out,
+         (unsigned long)bands[1].base_hz, bands[1].out);
+  else
+    LOGI("[WSPR] slot %lu: %s on %lu Hz (CLK%u)", (unsigned long)slot_epoch,
+         wspr_msg_name(type), (unsigned long)bands[0].base_hz, bands[0].out);
+  return bands[0].base_hz;
+}
+
+void wspr_cache_get_stats(wspr_cache_stats_t *out){
+  if (out) *out = s_cache_st;
+}
+
+void wspr_set_rf_base_hz(uint32_t hz){
+  cfg_lock();
+  s_bands[0].base_hz = hz;
+  cfg_unlock();
+}
+uint32_t wspr_get_rf_base_hz(void){ return s_bands[0].base_hz; }
 
 void wspr_set_tone_step_uHz(uint32_t uHz){ atomic_store(&g_tone_step_uHz, uHz); }
 uint32_t wspr_get_tone_step_uHz(void){ return atomic_load(&g_tone_step_uHz); }
@@ -39,88 +225,131 @@ static TaskHandle_t s_keyer_task = NULL;
 static _Atomic bool s_keyer_run = false;
 
 typedef struct {
-  wspr_frame_t frame;
-  uint32_t f0_hz;
+  const wspr_cached_frame_t *frame;
+  wspr_band_t band[2];      // band[1].base_hz 0 = single output
   uint32_t step_uHz;
+  boot_us_t t_start;        // the window's booked start: symbol 0's edge
 } keyer_ctx_t;
 
 static keyer_ctx_t s_ctx;
 
-// 8192 / 12000 s per symbol = 0.6826666667 s
-#define WSPR_SYMBOL_US  (uint64_t)682666
+// 8192 / 12000 s per symbol = 2048000 / 3 us (0.6826666... s), kept exact
+#define WSPR_SYMBOL_NUM 2048000u
+#define WSPR_SYMBOL_DEN 3u
 
 static void wspr_keyer_task(void *arg){
   (void)arg;
   LOGI("[WSPR] keyer task up");
 
   for(;;){
-    // Wait until start is requested
+    // Sleep until wspr_start() kicks us; no polling, so the core can idle
     while (!atomic_load(&s_keyer_run)){
-      vTaskDelay(pdMS_TO_TICKS(5));
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
     }
 
-    uint32_t f0 = s_ctx.f0_hz;
+    const wspr_band_t *b = s_ctx.band;
     uint32_t step_uHz = s_ctx.step_uHz;
 
-    // Precompute 4 tone freqs (integer Hz; SI5351 can do fractional via multisynth if you want later)
-    // For now we round to Hz; later you can keep a fractional accumulator or use SI5351 fractional synth.
-    uint32_t f_tone[4];
-    for (int i=0;i<4;i++){
-      // nearest Hz
-      uint64_t offset_uHz = (uint64_t)i * step_uHz;
-      uint32_t off_hz = (uint32_t)((offset_uHz + 500000)/1000000); // round
-      f_tone[i] = f0 + off_hz;
-    }
-
-    // Align our symbol schedule from *now*
-    absolute_time_t t = get_absolute_time();
-    // Give a tiny setup lead (1ms) then start
-    t = delayed_by_ms(t, 1);
-
+    radio_hw_select_outputs((uint8_t)((1u << b[0].out) | (b[1].base_hz ? 1u << b[1].out : 0u)));
     radio_hw_enable(true);
 
-    for (int n=0; n<WSPR_SYMS && atomic_load(&s_keyer_run); n++){
-      uint8_t sym = s_ctx.frame.symbols[n] & 3u;
-      radio_hw_set_freq_hz(f_tone[sym]);
-
-      // Next symbol deadline
-      t = delayed_by_us(t, WSPR_SYMBOL_US);
-      sleep_until(t);
+    // Tones are switched at exact edges (DMA sequencer on the SI5351 build,
+    // timer IRQ otherwise); we only wake at the end
+    symbol_play_t play = {
+      .symbols    = s_ctx.frame->symbols,
+      .n_symbols  = WSPR_SYMS,
+      .base_hz    = b[0].base_hz,
+      .step_uhz   = step_uHz,   // the radio keeps the 1.4648 Hz spacing exact
+      .out        = b[0].out,
+      .base2_hz   = b[1].base_hz,
+      .out2       = b[1].out,
+      .n_tones    = 4,
+      .period_num = WSPR_SYMBOL_NUM,
+      .period_den = WSPR_SYMBOL_DEN,
+      .start      = s_ctx.t_start,
+      .notify     = xTaskGetCurrentTaskHandle(),
+      .dma        = true,
+    };
+    ulTaskNotifyTake(pdTRUE, 0);
+    if (symbol_player_start(&play)){
+      // Past the deadline once armed: the player moved the whole frame up
+      symbol_player_stats_t st;
+      symbol_player_get_stats(&st);
+      if (st.last_start_late_us)
+        LOGW("[WSPR] keyed %lu us after the booked start", (unsigned long)st.last_start_late_us);
+      while (symbol_player_busy()) ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    } else {
+      LOGE("[WSPR] frame MISSED: symbol player busy or frame invalid");
     }
 
     radio_hw_enable(false);
+    radio_hw_select_outputs(1u);
     atomic_store(&s_keyer_run, false);
-    LOGI("[WSPR] keyer done");
+    taskENTER_CRITICAL();
+    s_on_air = NULL;
+    taskEXIT_CRITICAL();
+    symbol_player_stats_t st;
+    symbol_player_get_stats(&st);
+    LOGI("[WSPR] keyer done, edge error max %lu us, mean %lu us",
+         (unsigned long)st.last_err_max_us, (unsigned long)st.last_err_avg_us);
   }
 }
 
 // ===== Arbiter callbacks =====
-static void wspr_build_now(void){
-  if (!s_keyer_task){
-    xTaskCreate(wspr_keyer_task, "wsprkey", 2048, NULL, tskIDLE_PRIORITY+3, &s_keyer_task);
-  }
-  // Build a fresh frame with current config
-  wspr_frame_t f;
-  if (!wspr_build_frame(&g_cfg, &f)){
-    LOGE("[WSPR] build failed (cfg?)");
-    memset(&s_ctx, 0, sizeof(s_ctx));
-    return;
-  }
-  s_ctx.frame = f;
-  s_ctx.f0_hz = atomic_load(&g_rf_base_hz);
-  s_ctx.step_uHz = atomic_load(&g_tone_step_uHz);
-}
-
+// Key-up path: no encoding, no task creation, just claim the ready frame
 void wspr_start(void *user){
   (void)user;
   LOGI("[WSPR] START");
-  wspr_build_now();
+  if (!s_keyer_task || atomic_load(&s_keyer_run)) { LOGE("[WSPR] keyer not ready"); return; }
+
+  taskENTER_CRITICAL();
+  wspr_cached_frame_t *f = s_ready;
+  bool hit = f && cache_key_eq(f, &g_cfg, s_plan_type, &s_plan_tm);
+  s_on_air = f;
+  taskEXIT_CRITICAL();
+
+  if (hit) s_cache_st.hits++;
+  else {
+    // Only if a build failed or an input changed without going through a
+    // setter; pay for the encode here rather than skip the slot
+    s_cache_st.misses++;
+    cfg_lock();
+    bool ok = cache_rebuild();
+    taskENTER_CRITICAL();
+    s_on_air = ok ? s_ready : NULL;
+    f = s_on_air;
+    taskEXIT_CRITICAL();
+    cfg_unlock();
+    if (!f) return;
+  }
+
+  s_ctx.frame = f;
+  taskENTER_CRITICAL();
+  s_ctx.band[0] = s_plan_band[0];
+  s_ctx.band[1] = s_plan_band[1];
+  taskEXIT_CRITICAL();
+  s_ctx.step_uHz = atomic_load(&g_tone_step_uHz);
+  if (!radio_arbiter_active_start(&s_ctx.t_start)) s_ctx.t_start = timebase_boot_now();
   atomic_store(&s_keyer_run, true);
+  xTaskNotifyGive(s_keyer_task);
 }
 
 void wspr_stop(void *user){
   (void)user;
   LOGI("[WSPR] STOP");
   atomic_store(&s_keyer_run, false);
-  // arbiter will also call radio_hw_stop_all(); that’s fine.
-}
\ No newline at end of file
+  symbol_player_abort();
+  // the arbiter forces every output off right after this returns
+}
+
+void task_wspr_start(void){
+  if (s_keyer_task) return;
+  static StaticSemaphore_t mtx_buf;
+  static StackType_t stack[APP_STACK_WSPR_KEYER];
+  static StaticTask_t tcb;
+  s_cfg_mtx = xSemaphoreCreateMutexStatic(&mtx_buf);
+  app_rtos_register("wspr_cfg", sizeof(mtx_buf));
+  cache_rebuild();   // scheduler not running yet: nothing to race with
+  s_keyer_task = app_task_create(wspr_keyer_task, "wsprkey", NULL, APP_PRIO_WSPR_KEYER,
+                                 stack, APP_STACK_WSPR_KEYER, &tcb);
+}
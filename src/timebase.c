@@ -1,11 +1,53 @@
 // src/timebase.c
 #include "timebase.h"
 #include "pico/time.h"
+#include "FreeRTOS.h"
+#include "task.h"
 #include <stdatomic.h>
 
+// Clock model: UTC(t) = u0 + d - d*ppb/1e9 + slew(d), d = t - b0 (boot us).
+// ppb is the crystal's measured frequency error (+ = running fast); slew(d)
+// walks a small correction in at SLEW_PPM instead of stepping the clock.
+typedef struct {
+  uint64_t u0_us;     // UTC, us since epoch, at b0
+  uint64_t b0_us;     // boot us of the latch
+  int32_t  ppb;
+  int32_t  off_us;    // correction still being slewed in from b0
+} latch_t;
+
 static _Atomic bool     g_utc_valid = false;
-static _Atomic uint32_t g_epoch0    = 0;    // UTC seconds when we latched
-static uint64_t         g_boot0_ms  = 0;    // ms since boot when we latched
+static _Atomic uint32_t g_seq       = 0;    // seqlock over the latch below (odd = writing)
+static latch_t          g_l;
+static bool             g_from_pps  = false;// latch came from a PPS edge
+static uint8_t          g_disagree  = 0;    // consecutive latches that didn't fit
+
+// Frequency estimate: measured between latches a long baseline apart
+static bool             g_have_ppb  = false;
+static uint32_t         g_ppb_unc   = 0;    // uncertainty of g_l.ppb
+static uint64_t         g_fa_u_us   = 0;    // baseline anchor (UTC / boot us)
+static uint64_t         g_fa_b_us   = 0;
+static bool             g_fa_pps    = false;
+static uint32_t         g_steps = 0, g_slews = 0, g_freq_updates = 0;
+
+// Last PPS edge, written from the GPIO ISR
+static _Atomic uint32_t g_pps_seq   = 0;
+static uint64_t         g_pps_us    = 0;
+
+#define PPS_MAX_AGE_US    950000  // RMC for second N must land before edge N+1
+#define PPS_TOL_US          2000  // PPS latch must agree with the running one
+#define COARSE_TOL_US     500000  // UART-timed latch: just catch wrong-second errors
+#define STEP_AFTER             3  // consecutive disagreeing latches before we step
+
+#define SLEW_PPM             500  // 0.5 ms per second
+#define SLEW_MAX_US        20000  // bigger agreeing errors step instead (UART jitter)
+#define FREQ_MIN_PPS_S        60  // baseline for a PPS-to-PPS frequency measurement
+#define FREQ_MIN_UART_S     1200  // ... and when either end was UART-timed
+#define FREQ_TAU_S          3600  // blend weight: baseline / (baseline + tau)
+#define FREQ_MAX_PPB      200000  // RP2040 crystal is +/-30 ppm; beyond this is a bad pair
+#define PPB_UNC_INIT       50000  // before the first measurement
+#define PPB_UNC_FLOOR        100  // temperature swings in flight
+#define LATCH_ERR_PPS_US      10
+#define LATCH_ERR_UART_US  20000
 
 static inline bool is_leap(int y){ return (y%4==0 && (y%100!=0 || y%400==0)); }
 static int days_before_month(int y, int m){  // m = 1..12
@@ -32,40 +74,276 @@ static uint32_t ymd_hms_to_epoch(int Y, int M, int D, int h, int m, int s){
   return (uint32_t)( (uint64_t)days*86400ULL + (uint64_t)h*3600ULL + (uint64_t)m*60ULL + (uint64_t)s );
 }
 
+// Consistent snapshot of the latch. The writer can't be preempted mid-copy
+// (latch_write), so on one core a reader never sees an odd seq and never
+// spins; the check is what keeps a second core honest.
+static void latch_read(latch_t *l){
+  uint32_t s0, s1;
+  do {
+    s0 = atomic_load(&g_seq);
+    *l = g_l;
+    s1 = atomic_load(&g_seq);
+  } while ((s0 & 1u) || s0 != s1);
+}
+
+// A few words, with interrupts off: a higher-priority reader spinning on an
+// odd seq would otherwise starve the GPS task that's mid-write
+static void latch_write(const latch_t *l, bool from_pps){
+  taskENTER_CRITICAL();
+  atomic_fetch_add(&g_seq, 1);
+  g_l        = *l;
+  g_from_pps = from_pps;
+  atomic_fetch_add(&g_seq, 1);
+  taskEXIT_CRITICAL();
+  g_utc_valid = true;
+}
+
+// Part of off_us applied d us after the latch
+static int64_t slew_applied(const latch_t *l, int64_t d){
+  if (d <= 0 || !l->off_us) return 0;
+  int64_t max = d * SLEW_PPM / 1000000LL;
+  if (l->off_us > 0) return l->off_us < max ? l->off_us : max;
+  return -l->off_us < max ? l->off_us : -max;
+}
+
+static uint64_t model_utc_us(const latch_t *l, uint64_t boot_us){
+  int64_t d = (int64_t)(boot_us - l->b0_us);
+  return l->u0_us + (uint64_t)(d - d * l->ppb / 1000000000LL + slew_applied(l, d));
+}
+
+static uint64_t model_boot_us(const latch_t *l, uint64_t utc_us){
+  int64_t dd = (int64_t)(utc_us - l->u0_us);
+  int64_t d  = dd + dd * l->ppb / 1000000000LL;
+  d -= slew_applied(l, d);   // slew is <= SLEW_PPM, one pass is plenty
+  return l->b0_us + (uint64_t)d;
+}
+
+// Frequency error from the boot-time vs UTC span since the last anchor
+static void freq_update(uint64_t utc_us, uint64_t boot_us, bool from_pps, int32_t *ppb_io){
+  int64_t span_u = (int64_t)(utc_us - g_fa_u_us);
+  int64_t min_s  = (from_pps && g_fa_pps) ? FREQ_MIN_PPS_S : FREQ_MIN_UART_S;
+  if (g_fa_u_us && span_u >= 0 && span_u < min_s * 1000000LL)
+    return;
+
+  if (g_fa_u_us && span_u > 0){
+    int64_t span_b = (int64_t)(boot_us - g_fa_b_us);
+    int64_t ppb = (span_b - span_u) * 1000000000LL / span_u;
+    if (ppb > -FREQ_MAX_PPB && ppb < FREQ_MAX_PPB){
+      int64_t span_s = span_u / 1000000LL;
+      if (!g_have_ppb){
+        g_have_ppb = true;
+        *ppb_io = (int32_t)ppb;
+        // two latch errors over the baseline
+        int64_t jit = (from_pps && g_fa_pps) ? 2 * LATCH_ERR_PPS_US : 2 * LATCH_ERR_UART_US;
+        g_ppb_unc = (uint32_t)(jit * 1000LL / span_s) + PPB_UNC_FLOOR;
+      } else {
+        int64_t delta = ppb - *ppb_io;
+        int64_t w = (span_s << 8) / (span_s + FREQ_TAU_S);   // Q8
+        *ppb_io += (int32_t)((delta * w) >> 8);
+        uint32_t e = (uint32_t)(delta < 0 ? -delta : delta);
+        g_ppb_unc = (g_ppb_unc * 3u + e) / 4u;
+        if (g_ppb_unc < PPB_UNC_FLOOR) g_ppb_unc = PPB_UNC_FLOOR;
+      }
+      g_freq_updates++;
+    }
+  }
+  g_fa_u_us = utc_us;
+  g_fa_b_us = boot_us;
+  g_fa_pps  = from_pps;
+}
+
 bool timebase_is_valid(void){ return g_utc_valid; }
 bool timebase_utc_valid(void){ return g_utc_valid; }
+bool timebase_pps_locked(void){ return g_utc_valid && g_from_pps; }
 
 uint64_t timebase_now_boot_ms(void){
-  return to_ms_since_boot(get_absolute_time());
+  return time_us_64() / 1000ULL;
 }
 
-// ---- SHIM for legacy callers ----
-uint64_t timebase_now_ms(void){ return timebase_now_boot_ms(); }
+// ---- PPS: called from the GPIO ISR with the edge timestamp ----
+void timebase_pps_from_isr(uint64_t boot_us){
+  atomic_fetch_add(&g_pps_seq, 1);
+  g_pps_us = boot_us;
+  atomic_fetch_add(&g_pps_seq, 1);
+}
+
+static bool pps_last_edge(uint64_t *edge_us){
+  uint32_t s0, s1;
+  do {
+    s0 = atomic_load(&g_pps_seq);
+    *edge_us = g_pps_us;
+    s1 = atomic_load(&g_pps_seq);
+  } while ((s0 & 1u) || s0 != s1);
+  return s0 != 0;
+}
+
+// Bind UTC second `epoch_sec` to boot time `boot_us`. Only moves the latch
+// when the new pairing agrees with the current one, so a single late RMC or a
+// PPS edge paired with the wrong second can't yank the clock around.
+// Small agreeing errors are slewed in, everything else steps.
+static void latch_candidate(uint32_t epoch_sec, uint64_t boot_us, bool from_pps){
+  uint64_t utc_us = (uint64_t)epoch_sec * 1000000ULL;
+  latch_t l = g_l;    // single writer (GPS task)
+
+  if (!g_utc_valid){
+    freq_update(utc_us, boot_us, from_pps, &l.ppb);
+    l.u0_us = utc_us; l.b0_us = boot_us; l.off_us = 0;
+    latch_write(&l, from_pps);
+    return;
+  }
+
+  uint64_t predicted = model_utc_us(&l, boot_us);
+  int64_t err = (int64_t)(utc_us - predicted);    // + = our clock is behind
+  int64_t aerr = err < 0 ? -err : err;
 
-// Latch UTC mapping using epoch seconds
+  bool cur_pps = g_from_pps;
+  int64_t tol = (from_pps && cur_pps) ? PPS_TOL_US : COARSE_TOL_US;
+
+  if (aerr <= tol){
+    g_disagree = 0;
+    // a UART-timed latch never replaces a PPS one; it only confirms the second
+    if (!(from_pps || !cur_pps))
+      return;
+    freq_update(utc_us, boot_us, from_pps, &l.ppb);
+    l.b0_us = boot_us;
+    if (aerr <= SLEW_MAX_US){
+      // continue from where the old model was; walk the difference in
+      l.u0_us  = predicted;
+      l.off_us = (int32_t)err;
+      if (aerr > 1) g_slews++;   // 1 us is just rounding
+    } else {
+      l.u0_us  = utc_us;
+      l.off_us = 0;
+      g_steps++;
+    }
+    latch_write(&l, from_pps);
+    return;
+  }
+
+  if (++g_disagree >= STEP_AFTER){
+    g_disagree = 0;
+    // the old baseline anchor belongs to a different mapping
+    g_fa_u_us = 0;
+    freq_update(utc_us, boot_us, from_pps, &l.ppb);
+    l.u0_us = utc_us; l.b0_us = boot_us; l.off_us = 0;
+    latch_write(&l, from_pps);
+    g_steps++;
+  }
+}
+
+// Latch UTC mapping using epoch seconds (no PPS: "now" is the best we have)
 void timebase_set_utc_now(uint32_t epoch_sec){
-  g_epoch0   = epoch_sec;
-  g_boot0_ms = timebase_now_boot_ms();
-  g_utc_valid = true;
+  latch_t l = g_l;
+  l.u0_us  = (uint64_t)epoch_sec * 1000000ULL;
+  l.b0_us  = time_us_64();
+  l.off_us = 0;
+  latch_write(&l, false);
+  g_steps++;
 }
 
 // ---- SHIM: accept RMC fields (yy=00..99, UTC) ----
-void timebase_set_utc_from_rmc(int hh, int mm, int ss, int day, int mon, int yy){
+void timebase_set_utc_from_rmc(int hh, int mm, int ss, int ms, int day, int mon, int yy){
   // UBX/NMEA RMC gives year as two digits: 00..99 => interpret as 2000..2099
   int year = (yy < 70) ? (2000 + yy) : (1900 + yy); // if your module is 20xx only, use 2000+yy
   uint32_t epoch = ymd_hms_to_epoch(year, mon, day, hh, mm, ss);
-  timebase_set_utc_now(epoch);
+
+  uint64_t now_us = time_us_64();
+  uint64_t edge_us;
+  if (ms == 0 && pps_last_edge(&edge_us) && now_us - edge_us < PPS_MAX_AGE_US){
+    // RMC for second N follows PPS edge N: that edge *is* the top of the second
+    latch_candidate(epoch, edge_us, true);
+  } else {
+    // No usable edge: fall back to parse time, minus the sentence's own fraction
+    latch_candidate(epoch, now_us - (uint64_t)ms * 1000ULL, false);
+  }
 }
 
 uint32_t timebase_utc_now(void){
   if (!g_utc_valid) return 0;
-  uint64_t now_ms = timebase_now_boot_ms();
-  uint64_t delta_ms = (now_ms - g_boot0_ms);
-  return (uint32_t)(g_epoch0 + (delta_ms / 1000ULL));
+  latch_t l;
+  latch_read(&l);
+  return (uint32_t)(model_utc_us(&l, time_us_64()) / 1000000ULL);
 }
 
-uint64_t timebase_epoch_to_boot_ms(uint32_t epoch_sec){
-  if (!g_utc_valid) return 0;
-  int64_t delta_s = (int64_t)epoch_sec - (int64_t)g_epoch0;
-  return g_boot0_ms + (uint64_t)(delta_s * 1000LL);
-}
\ No newline at end of file
+boot_us_t timebase_boot_now(void){
+  return (boot_us_t){ time_us_64() };
+}
+
+bool timebase_now(boot_us_t *boot, utc_us_t *utc){
+  latch_t l;
+  latch_read(&l);
+  uint64_t t = time_us_64();
+  if (boot) boot->us = t;
+  if (!g_utc_valid){
+    if (utc) utc->us = 0;
+    return false;
+  }
+  if (utc) utc->us = model_utc_us(&l, t);
+  return true;
+}
+
+bool timebase_utc_at(boot_us_t b, utc_us_t *out){
+  if (!g_utc_valid) return false;
+  latch_t l;
+  latch_read(&l);
+  out->us = model_utc_us(&l, b.us);
+  return true;
+}
+
+bool timebase_boot_at(utc_us_t u, boot_us_t *out){
+  if (!g_utc_valid) return false;
+  latch_t l;
+  latch_read(&l);
+  out->us = model_boot_us(&l, u.us);
+  return true;
+}
+
+TickType_t timebase_ticks_until(boot_us_t deadline){
+  uint64_t now = time_us_64();
+  if (deadline.us <= now) return 0;
+  uint64_t t = ((deadline.us - now) * configTICK_RATE_HZ + 999999ULL) / 1000000ULL;
+  return t >= portMAX_DELAY ? portMAX_DELAY - 1 : (TickType_t)t;
+}
+
+void timebase_delay_until(boot_us_t deadline){
+  TickType_t t = timebase_ticks_until(deadline);
+  if (t) vTaskDelay(t);
+}
+
+// Holdover error at boot time t: latch error + what's left to slew +
+// frequency uncertainty integrated since the latch
+static uint32_t error_at(const latch_t *l, uint64_t boot_us){
+  int64_t d = (int64_t)(boot_us - l->b0_us);
+  if (d < 0) d = 0;
+  int64_t left = (int64_t)l->off_us - slew_applied(l, d);
+  uint64_t e = (g_from_pps ? LATCH_ERR_PPS_US : LATCH_ERR_UART_US)
+             + (uint64_t)(left < 0 ? -left : left)
+             + (uint64_t)d * (g_have_ppb ? g_ppb_unc : PPB_UNC_INIT) / 1000000000ULL;
+  return e > 0xFFFFFFF0ULL ? 0xFFFFFFF0u : (uint32_t)e;
+}
+
+uint32_t timebase_error_us_at(uint32_t epoch_sec){
+  if (!g_utc_valid) return UINT32_MAX;
+  latch_t l;
+  latch_read(&l);
+  uint64_t b = model_boot_us(&l, (uint64_t)epoch_sec * 1000000ULL);
+  uint64_t now = time_us_64();
+  return error_at(&l, b > now ? b : now);
+}
+
+void timebase_get_status(timebase_status_t *out){
+  if (!out) return;
+  latch_t l;
+  latch_read(&l);
+  uint64_t now = time_us_64();
+  out->valid        = g_utc_valid;
+  out->pps          = g_from_pps;
+  out->ppb          = l.ppb;
+  out->ppb_unc      = g_have_ppb ? g_ppb_unc : PPB_UNC_INIT;
+  out->err_us       = g_utc_valid ? error_at(&l, now) : UINT32_MAX;
+  out->age_s        = g_utc_valid ? (uint32_t)((now - l.b0_us) / 1000000ULL) : 0;
+  out->slewing_us   = (int32_t)(l.off_us - slew_applied(&l, (int64_t)(now - l.b0_us)));
+  out->steps        = g_steps;
+  out->slews        = g_slews;
+  out->freq_updates = g_freq_updates;
+}
@@ -0,0 +1,33 @@
+// src/timing_hist.c
+#include "timing_hist.h"
+#include <stdio.h>
+
+const uint32_t timing_hist_edge_us[TIMING_HIST_BINS - 1] = {
+  10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 50000, 100000, 500000, 1000000 };
+
+void timing_hist_add(timing_hist_t *h, uint32_t us){
+  int i = 0;
+  while (i < TIMING_HIST_BINS - 1 && us >= timing_hist_edge_us[i]) i++;
+  h->bin[i]++;
+  h->n++;
+  if (us > h->max_us) h->max_us = us;
+}
+
+static int edge_label(uint32_t us, char *buf, size_t len){
+  if (us >= 1000000u && us % 1000000u == 0) return snprintf(buf, len, "%lus", (unsigned long)(us / 1000000u));
+  if (us >= 1000u && us % 1000u == 0)       return snprintf(buf, len, "%lums", (unsigned long)(us / 1000u));
+  return snprintf(buf, len, "%lu", (unsigned long)us);
+}
+
+size_t timing_hist_format(const timing_hist_t *h, char *buf, size_t len){
+  if (!len) return 0;
+  size_t o = (size_t)snprintf(buf, len, "n=%lu max=%luus", (unsigned long)h->n, (unsigned long)h->max_us);
+  for (int i = 0; i < TIMING_HIST_BINS && o < len; i++){
+    if (!h->bin[i]) continue;
+    char lab[12];
+    if (i < TIMING_HIST_BINS - 1) { lab[0] = '<'; edge_label(timing_hist_edge_us[i], lab + 1, sizeof(lab) - 1); }
+    else { lab[0] = '>'; lab[1] = '='; edge_label(timing_hist_edge_us[i - 1], lab + 2, sizeof(lab) - 2); }
+    o += (size_t)snprintf(buf + o, len - o, " %s:%lu", lab, (unsigned long)h->bin[i]);
+  }
+  return o < len ? o : len - 1;
+}